@@ -0,0 +1,397 @@
+/** mc_rtc GUI client benchmark
+ *
+ * Feeds synthetic GUI data to MujocoClient without a controller: the elements are published by an
+ * mc_rtc::gui::StateBuilder in the same process and the serialized state is handed to the client on every frame.
+ * The scene holds thousands of polygons and trajectories, hundreds of interactive markers and visuals, and forces and
+ * arrows that change on every frame. The benchmark reports the CPU time of each stage of the GUI and the amount of
+ * geometry generated.
+ *
+ * As the rendering benchmark, it uses Mesa's software rasterizer by default and needs a display (use xvfb-run).
+ */
+
+#include "MujocoClient.h"
+#include "mj_render_profiler.h"
+#include "mj_utils.h"
+
+#include "ImGuizmo.h"
+#include "backends/imgui_impl_glfw.h"
+#include "backends/imgui_impl_opengl3.h"
+#include "implot.h"
+
+#include <mc_rtc/gui.h>
+#include <mc_rtc/logging.h>
+
+#include <fmt/format.h>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace mc_mujoco;
+
+namespace
+{
+
+/** Phases reported by the benchmark */
+constexpr MjRenderProfiler::Phase PHASES[] = {MjRenderProfiler::ClientUpdate, MjRenderProfiler::Draw2D,
+                                              MjRenderProfiler::Draw3D, MjRenderProfiler::ImGui,
+                                              MjRenderProfiler::Swap};
+
+/** Number of elements of each kind */
+struct Counts
+{
+  size_t polygons = 2000;
+  size_t trajectories = 2000;
+  size_t trajectory_points = 100;
+  size_t markers = 200;
+  size_t forces = 200;
+  size_t arrows = 200;
+  size_t visuals = 200;
+};
+
+/** Position of the i-th element of a kind on a square grid of the given size centered on the origin */
+Eigen::Vector3d grid(size_t i, size_t n, double size, double z)
+{
+  size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(std::max<size_t>(n, 1)))));
+  double step = size / static_cast<double>(columns);
+  return {step * static_cast<double>(i % columns) - 0.5 * size, step * static_cast<double>(i / columns) - 0.5 * size,
+          z};
+}
+
+rbd::parsers::Visual make_visual(size_t i)
+{
+  using Geometry = rbd::parsers::Geometry;
+  rbd::parsers::Visual visual;
+  visual.origin = sva::PTransformd::Identity();
+  switch(i % 3)
+  {
+    case 0:
+    {
+      Geometry::Box box;
+      box.size = Eigen::Vector3d(0.1, 0.2, 0.3);
+      visual.geometry.type = Geometry::Type::BOX;
+      visual.geometry.data = box;
+      break;
+    }
+    case 1:
+    {
+      Geometry::Sphere sphere;
+      sphere.radius = 0.1;
+      visual.geometry.type = Geometry::Type::SPHERE;
+      visual.geometry.data = sphere;
+      break;
+    }
+    default:
+    {
+      Geometry::Cylinder cylinder;
+      cylinder.radius = 0.05;
+      cylinder.length = 0.3;
+      visual.geometry.type = Geometry::Type::CYLINDER;
+      visual.geometry.data = cylinder;
+      break;
+    }
+  }
+  rbd::parsers::Material::Color color;
+  color.color = Eigen::Vector4d(0.2, 0.6, 0.9, 1.0);
+  visual.material.type = rbd::parsers::Material::Type::COLOR;
+  visual.material.data = color;
+  return visual;
+}
+
+/** Elements published to the client, their data lives here so that the callbacks of the builder can refer to it */
+struct StressScene
+{
+  StressScene(mc_rtc::gui::StateBuilder & builder, const Counts & counts, bool dynamic) : dynamic_(dynamic)
+  {
+    using namespace mc_rtc::gui;
+    polygons_.resize(counts.polygons);
+    for(size_t i = 0; i < counts.polygons; ++i)
+    {
+      Eigen::Vector3d c = grid(i, counts.polygons, 20.0, 0.0);
+      polygons_[i] = {c + Eigen::Vector3d(-0.1, -0.1, 0), c + Eigen::Vector3d(0.1, -0.1, 0),
+                      c + Eigen::Vector3d(0.1, 0.1, 0), c + Eigen::Vector3d(-0.1, 0.1, 0)};
+      auto get = [this, i]() -> const std::vector<Eigen::Vector3d> & { return polygons_[i]; };
+      builder.addElement({"Stress", "Polygons"}, Polygon(fmt::format("polygon_{}", i), Color::Red, get));
+    }
+    trajectories_.resize(counts.trajectories);
+    for(size_t i = 0; i < counts.trajectories; ++i)
+    {
+      Eigen::Vector3d c = grid(i, counts.trajectories, 20.0, 0.5);
+      for(size_t j = 0; j < counts.trajectory_points; ++j)
+      {
+        double s = 2 * M_PI * static_cast<double>(j) / static_cast<double>(counts.trajectory_points);
+        trajectories_[i].push_back(c + Eigen::Vector3d(0.2 * std::cos(s), 0.2 * std::sin(s), 0.05 * s));
+      }
+      auto get = [this, i]() -> const std::vector<Eigen::Vector3d> & { return trajectories_[i]; };
+      builder.addElement({"Stress", "Trajectories"},
+                         Trajectory(fmt::format("trajectory_{}", i), LineConfig(Color::Blue), get));
+    }
+    markers_.resize(counts.markers);
+    for(size_t i = 0; i < counts.markers; ++i)
+    {
+      markers_[i] = sva::PTransformd(grid(i, counts.markers, 10.0, 1.0));
+      auto get = [this, i]() -> const sva::PTransformd & { return markers_[i]; };
+      auto set = [this, i](const sva::PTransformd & pos) { markers_[i] = pos; };
+      builder.addElement({"Stress", "Markers"}, Transform(fmt::format("marker_{}", i), get, set));
+    }
+    for(size_t i = 0; i < counts.forces; ++i)
+    {
+      sva::PTransformd surface(grid(i, counts.forces, 10.0, 1.5));
+      auto force = [this, i]() {
+        return sva::ForceVecd(Eigen::Vector3d::Zero(), Eigen::Vector3d(0, 50.0 * std::sin(t_ + 0.1 * i), 200.0));
+      };
+      auto get_surface = [surface]() { return surface; };
+      builder.addElement({"Stress", "Forces"},
+                         Force(fmt::format("force_{}", i), ForceConfig(Color::Green), force, get_surface));
+    }
+    for(size_t i = 0; i < counts.arrows; ++i)
+    {
+      Eigen::Vector3d start = grid(i, counts.arrows, 10.0, 2.0);
+      auto end = [this, i, start]() -> Eigen::Vector3d {
+        return start + Eigen::Vector3d(0.3 * std::cos(t_ + i), 0.3 * std::sin(t_ + i), 0.3);
+      };
+      builder.addElement({"Stress", "Arrows"}, Arrow(fmt::format("arrow_{}", i), ArrowConfig(Color::Magenta),
+                                                     [start]() { return start; }, end));
+    }
+    visuals_.resize(counts.visuals);
+    for(size_t i = 0; i < counts.visuals; ++i)
+    {
+      visuals_[i] = make_visual(i);
+      sva::PTransformd pos(grid(i, counts.visuals, 10.0, 2.5));
+      auto get = [this, i]() -> const rbd::parsers::Visual & { return visuals_[i]; };
+      builder.addElement({"Stress", "Visuals"}, Visual(fmt::format("visual_{}", i), get, [pos]() { return pos; }));
+    }
+  }
+
+  /** Move the time-dependent elements, polygons and trajectories also change if the scene is dynamic */
+  void update(double t)
+  {
+    t_ = t;
+    if(!dynamic_)
+    {
+      return;
+    }
+    Eigen::Vector3d offset(0, 0, 0.01 * std::sin(t));
+    for(auto & p : polygons_)
+    {
+      for(auto & v : p)
+      {
+        v.z() = offset.z();
+      }
+    }
+    for(auto & trajectory : trajectories_)
+    {
+      trajectory.front().z() = offset.z();
+    }
+  }
+
+private:
+  bool dynamic_;
+  double t_ = 0.0;
+  std::vector<std::vector<Eigen::Vector3d>> polygons_;
+  std::vector<std::vector<Eigen::Vector3d>> trajectories_;
+  std::vector<sva::PTransformd> markers_;
+  std::vector<rbd::parsers::Visual> visuals_;
+};
+
+/** Look at the center of the grid from a point on a circle around it */
+void set_camera(double azimuth, int width, int height)
+{
+  Eigen::Vector3f eye(15.0f * static_cast<float>(std::cos(azimuth)), 15.0f * static_cast<float>(std::sin(azimuth)),
+                      8.0f);
+  Eigen::Vector3f f = -eye.normalized();
+  Eigen::Vector3f s = f.cross(Eigen::Vector3f::UnitZ()).normalized();
+  Eigen::Vector3f u = s.cross(f);
+  Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+  view.block<1, 3>(0, 0) = s.transpose();
+  view.block<1, 3>(1, 0) = u.transpose();
+  view.block<1, 3>(2, 0) = -f.transpose();
+  view.block<3, 1>(0, 3) = -view.topLeftCorner<3, 3>() * eye;
+  float znear = 0.1f;
+  float zfar = 100.0f;
+  float top = znear * std::tan(0.5f * 45.0f * static_cast<float>(M_PI) / 180.0f);
+  float right = top * static_cast<float>(width) / static_cast<float>(height);
+  Eigen::Matrix4f projection = Eigen::Matrix4f::Zero();
+  projection(0, 0) = znear / right;
+  projection(1, 1) = znear / top;
+  projection(2, 2) = -(zfar + znear) / (zfar - znear);
+  projection(2, 3) = -2.0f * zfar * znear / (zfar - znear);
+  projection(3, 2) = -1.0f;
+  // MujocoClient reads the matrices of the view from the OpenGL state as mjr_render leaves them
+  glMatrixMode(GL_PROJECTION);
+  glLoadMatrixf(projection.data());
+  glMatrixMode(GL_MODELVIEW);
+  glLoadMatrixf(view.data());
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+  Counts counts;
+  size_t frames = 300;
+  size_t warmup = 20;
+  int width = 1280;
+  int height = 720;
+  bool dynamic = false;
+  bool orbit = false;
+  bool hardware = false;
+  {
+    po::options_description desc("mc_mujoco GUI benchmark options");
+    // clang-format off
+    desc.add_options()
+      ("help", "Show this help message")
+      ("polygons", po::value<size_t>(&counts.polygons), "Number of polygons")
+      ("trajectories", po::value<size_t>(&counts.trajectories), "Number of trajectories")
+      ("trajectory-points", po::value<size_t>(&counts.trajectory_points), "Number of points of each trajectory")
+      ("markers", po::value<size_t>(&counts.markers), "Number of interactive markers")
+      ("forces", po::value<size_t>(&counts.forces), "Number of forces")
+      ("arrows", po::value<size_t>(&counts.arrows), "Number of arrows")
+      ("visuals", po::value<size_t>(&counts.visuals), "Number of visuals")
+      ("dynamic", po::bool_switch(&dynamic), "Change the polygons and trajectories on every frame")
+      ("orbit", po::bool_switch(&orbit), "Move the camera on every frame")
+      ("frames", po::value<size_t>(&frames), "Frames measured (at most 300)")
+      ("warmup", po::value<size_t>(&warmup), "Frames drawn before the measure")
+      ("width", po::value<int>(&width), "Width of the window")
+      ("height", po::value<int>(&height), "Height of the window")
+      ("hardware", po::bool_switch(&hardware), "Use the default OpenGL driver rather than the software rasterizer");
+    // clang-format on
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+    if(vm.count("help"))
+    {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  }
+  frames = std::min(std::max<size_t>(frames, 1), MjRenderProfiler::history_size);
+
+  if(!hardware)
+  {
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+  }
+  if(!glfwInit())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLFW initialization failed");
+  }
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow * window = glfwCreateWindow(width, height, "mc_mujoco GUI benchmark", NULL, NULL);
+  if(!window)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLFW window creation failed");
+  }
+  glfwMakeContextCurrent(window);
+  mujoco_init_gl();
+  glfwSwapInterval(0);
+  mc_rtc::log::info("[mc_mujoco] OpenGL renderer: {}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+  ImGui::CreateContext();
+  ImPlot::CreateContext();
+  ImGui::GetIO().IniFilename = nullptr;
+  ImGui_ImplGlfw_InitForOpenGL(window, false);
+  ImGui_ImplOpenGL3_Init("#version 130");
+
+  // The client owns GPU buffers, it is destroyed before the OpenGL context
+  {
+    mc_rtc::gui::StateBuilder builder;
+    StressScene stress(builder, counts, dynamic);
+    std::vector<char> buffer;
+    MujocoClient client;
+    MjRenderProfiler profiler;
+    double serialize_ms = 0.0;
+    size_t lines = 0;
+    size_t triangles = 0;
+    size_t meshes = 0;
+    size_t reused = 0;
+    size_t regenerated = 0;
+    size_t culled = 0;
+    size_t bytes = 0;
+
+    for(size_t i = 0; i < warmup + frames; ++i)
+    {
+      if(i == warmup)
+      {
+        profiler.reset();
+        serialize_ms = 0.0;
+        lines = triangles = meshes = reused = regenerated = culled = bytes = 0;
+      }
+      double t = static_cast<double>(i) / 60.0;
+      stress.update(t);
+      auto start = std::chrono::steady_clock::now();
+      size_t size = builder.update(buffer);
+      serialize_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      bytes += size;
+
+      glfwPollEvents();
+      int fb_width = width;
+      int fb_height = height;
+      glfwGetFramebufferSize(window, &fb_width, &fb_height);
+      glViewport(0, 0, fb_width, fb_height);
+      glClearColor(0.3f, 0.5f, 0.7f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      set_camera(orbit ? 0.2 * t : 0.0, fb_width, fb_height);
+
+      profiler.start();
+      client.run(buffer.data(), size);
+      profiler.mark(MjRenderProfiler::ClientUpdate);
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+      ImGuizmo::BeginFrame();
+      ImGuiIO & io = ImGui::GetIO();
+      ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
+      profiler.mark(MjRenderProfiler::ImGui);
+      client.draw2D(window);
+      profiler.mark(MjRenderProfiler::Draw2D);
+      client.draw3D();
+      profiler.mark(MjRenderProfiler::Draw3D);
+      ImGui::Render();
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      profiler.mark(MjRenderProfiler::ImGui);
+      glfwSwapBuffers(window);
+      glFinish();
+      profiler.mark(MjRenderProfiler::Swap);
+      profiler.end();
+
+      const auto & batch = client.batch();
+      lines += batch.lines();
+      triangles += batch.triangles();
+      meshes += batch.meshes();
+      reused += batch.reused();
+      regenerated += batch.regenerated();
+      culled += client.culled();
+    }
+
+    auto per_frame = [&](size_t total) { return static_cast<double>(total) / static_cast<double>(frames); };
+    fmt::print("{} polygons, {} trajectories of {} points, {} markers, {} forces, {} arrows, {} visuals{}{}\n",
+               counts.polygons, counts.trajectories, counts.trajectory_points, counts.markers, counts.forces,
+               counts.arrows, counts.visuals, dynamic ? ", dynamic" : "", orbit ? ", orbiting camera" : "");
+    fmt::print("Average over {} frames:\n", frames);
+    fmt::print("  {:<16} {:>8.2f}ms ({:.0f} bytes)\n", "Serialization", serialize_ms / static_cast<double>(frames),
+               per_frame(bytes));
+    double total = 0.0;
+    for(auto phase : PHASES)
+    {
+      total += profiler.average(phase);
+      fmt::print("  {:<16} {:>8.2f}ms\n", MjRenderProfiler::name(phase), profiler.average(phase));
+    }
+    fmt::print("  {:<16} {:>8.2f}ms\n", "Total", total);
+    fmt::print("  {:.0f} lines, {:.0f} triangles, {:.0f} meshes\n", per_frame(lines), per_frame(triangles),
+               per_frame(meshes));
+    fmt::print("  {:.0f} cached elements re-used, {:.0f} generated, {:.0f} culled\n", per_frame(reused),
+               per_frame(regenerated), per_frame(culled));
+  }
+
+  ImGui_ImplOpenGL3_Shutdown();
+  ImGui_ImplGlfw_Shutdown();
+  ImPlot::DestroyContext();
+  ImGui::DestroyContext();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
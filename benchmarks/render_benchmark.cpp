@@ -0,0 +1,444 @@
+/** Rendering benchmark
+ *
+ * Replays a state trace in the standard scenes and reports the time spent in each phase of a frame (scene update, GUI
+ * geometry generation and drawing, mjr_render, ImGui and swap) for several resolutions and visualization settings.
+ *
+ * By default the OpenGL context is created with Mesa's software rasterizer (LIBGL_ALWAYS_SOFTWARE) so the numbers do
+ * not depend on the GPU of the machine. A display is still needed to create the window, use xvfb-run on a headless
+ * node.
+ */
+
+#include "BatchRenderer.h"
+#include "mj_mesh_lod.h"
+#include "mj_render_profiler.h"
+#include "mj_utils.h"
+
+#include "glfw3.h"
+
+#include "backends/imgui_impl_glfw.h"
+#include "backends/imgui_impl_opengl3.h"
+#include "imgui.h"
+#include "implot.h"
+
+#include <mc_rtc/logging.h>
+
+#include <fmt/format.h>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace mc_mujoco;
+
+namespace
+{
+
+/** Visualization settings measured for every scene and resolution */
+struct Setting
+{
+  const char * name;
+  bool shadows;
+  bool reflections;
+  bool skybox;
+  /** Show the collision geoms and the contact forces */
+  bool collisions;
+};
+
+constexpr Setting SETTINGS[] = {{"full", true, true, true, false},
+                                {"no-shadows-reflections", false, false, true, false},
+                                {"collisions", true, true, true, true}};
+
+/** Phases reported by the benchmark */
+constexpr MjRenderProfiler::Phase PHASES[] = {MjRenderProfiler::Scene,  MjRenderProfiler::ClientUpdate,
+                                              MjRenderProfiler::Draw3D, MjRenderProfiler::Render,
+                                              MjRenderProfiler::ImGui,  MjRenderProfiler::Swap};
+
+struct Scene
+{
+  std::string name;
+  std::string xml;
+};
+
+/** Positions of the model at every frame */
+using Trace = std::vector<std::vector<double>>;
+
+/** Read a trace with one state per line (nq values separated by spaces), returns an empty trace on failure */
+Trace read_trace(const std::string & path, int nq)
+{
+  Trace trace;
+  std::ifstream ifs(path);
+  std::string line;
+  while(std::getline(ifs, line))
+  {
+    std::istringstream iss(line);
+    std::vector<double> qpos;
+    double q;
+    while(iss >> q)
+    {
+      qpos.push_back(q);
+    }
+    if(qpos.empty())
+    {
+      continue;
+    }
+    if(qpos.size() != static_cast<size_t>(nq))
+    {
+      mc_rtc::log::error("[mc_mujoco] {} has states of size {} but the model has {} positions", path, qpos.size(), nq);
+      return {};
+    }
+    trace.push_back(std::move(qpos));
+  }
+  return trace;
+}
+
+/** Record a trace of the passive dynamics of the model from its reference configuration */
+Trace make_trace(const mjModel * model, mjData * data, size_t frames)
+{
+  Trace trace;
+  mj_resetData(model, data);
+  // One frame every 1/60s of simulation
+  int steps = std::max(static_cast<int>(1.0 / (60.0 * model->opt.timestep)), 1);
+  for(size_t i = 0; i < frames; ++i)
+  {
+    for(int s = 0; s < steps; ++s)
+    {
+      mj_step(model, data);
+    }
+    trace.emplace_back(data->qpos, data->qpos + model->nq);
+  }
+  return trace;
+}
+
+void write_trace(const std::string & path, const Trace & trace)
+{
+  std::ofstream ofs(path);
+  for(const auto & qpos : trace)
+  {
+    for(size_t i = 0; i < qpos.size(); ++i)
+    {
+      ofs << (i ? " " : "") << qpos[i];
+    }
+    ofs << "\n";
+  }
+}
+
+/** Emit the GUI elements of a typical controller: a frame on every body and the recent path of the bodies */
+void emit_gui(const mjModel * model,
+              const mjData * data,
+              const std::vector<std::vector<Eigen::Vector3d>> & paths,
+              BatchRenderer & batch)
+{
+  static const mc_rtc::gui::Color red(1, 0, 0, 1);
+  static const mc_rtc::gui::Color green(0, 1, 0, 1);
+  static const mc_rtc::gui::Color blue(0, 0, 1, 1);
+  static const mc_rtc::gui::Color yellow(1, 1, 0, 1);
+  for(int b = 1; b < model->nbody; ++b)
+  {
+    Eigen::Vector3d pos = Eigen::Map<const Eigen::Vector3d>(data->xpos + 3 * b);
+    Eigen::Matrix3d R = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(data->xmat + 9 * b);
+    batch.arrow(pos, pos + 0.15 * R.col(0), 0.01, 0.02, 0.03, red);
+    batch.arrow(pos, pos + 0.15 * R.col(1), 0.01, 0.02, 0.03, green);
+    batch.arrow(pos, pos + 0.15 * R.col(2), 0.01, 0.02, 0.03, blue);
+    batch.sphere(Eigen::Map<const Eigen::Vector3d>(data->xipos + 3 * b), 0.02, yellow);
+    const auto & path = paths[b];
+    for(size_t i = 1; i < path.size(); ++i)
+    {
+      batch.line(path[i - 1], path[i], yellow);
+    }
+  }
+}
+
+/** Draw a panel similar to the simulation panel and the profiler chart */
+void draw_imgui(MjRenderProfiler & profiler, const std::string & title)
+{
+  ImGui::SetNextWindowSize({400, 300}, ImGuiCond_FirstUseEver);
+  ImGui::Begin("mc_mujoco benchmark");
+  ImGui::Text("%s", title.c_str());
+  for(auto phase : PHASES)
+  {
+    ImGui::Text("%s: %.2fms", MjRenderProfiler::name(phase), profiler.average(phase));
+  }
+  profiler.draw();
+  ImGui::End();
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+  std::vector<std::string> xmls;
+  std::string resolutions_str = "640x480,1280x720,1920x1080";
+  std::string trace_path;
+  std::string record_trace;
+  std::string csv;
+  size_t frames = 200;
+  size_t warmup = 20;
+  bool hardware = false;
+  bool mesh_lod = false;
+  {
+    po::options_description desc("mc_mujoco rendering benchmark options");
+    // clang-format off
+    desc.add_options()
+      ("help", "Show this help message")
+      ("scene", po::value<std::vector<std::string>>(&xmls), "Additional MuJoCo model to benchmark (repeatable)")
+      ("resolutions", po::value<std::string>(&resolutions_str), "Comma-separated list of WxH resolutions")
+      ("trace", po::value<std::string>(&trace_path), "State trace to replay (one qpos per line)")
+      ("record-trace", po::value<std::string>(&record_trace), "Save the generated trace of each scene with this prefix")
+      ("frames", po::value<size_t>(&frames), "Frames measured for each configuration (at most 300)")
+      ("warmup", po::value<size_t>(&warmup), "Frames rendered before the measure")
+      ("csv", po::value<std::string>(&csv), "Write the results to a CSV file")
+      ("hardware", po::bool_switch(&hardware), "Use the default OpenGL driver rather than the software rasterizer")
+      ("mesh-lod", po::bool_switch(&mesh_lod), "Generate and use the mesh levels of detail");
+    // clang-format on
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+    if(vm.count("help"))
+    {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  }
+  frames = std::min(std::max<size_t>(frames, 1), MjRenderProfiler::history_size);
+
+  std::vector<std::pair<int, int>> resolutions;
+  {
+    std::istringstream iss(resolutions_str);
+    std::string r;
+    while(std::getline(iss, r, ','))
+    {
+      int w = 0;
+      int h = 0;
+      if(std::sscanf(r.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+      {
+        mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Invalid resolution: {}", r);
+      }
+      resolutions.push_back({w, h});
+    }
+    if(resolutions.empty())
+    {
+      mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] No resolution to benchmark");
+    }
+  }
+
+  std::vector<Scene> scenes;
+  {
+    std::string robots = MC_MUJOCO_BENCHMARK_ROBOTS;
+    auto merged = [&](const std::vector<std::string> & objects) {
+      std::map<std::string, std::string> mujocoObjects;
+      for(const auto & o : objects)
+      {
+        mujocoObjects[o] = robots + "/" + o + ".xml";
+      }
+      std::vector<MjRobot> mjRobots;
+      return merge_mujoco_models(mujocoObjects, {}, mjRobots, mesh_lod);
+    };
+    scenes.push_back({"ground", merged({"ground"})});
+    scenes.push_back({"ground+box", merged({"ground", "box"})});
+    scenes.push_back({"ground+box+longtable", merged({"ground", "box", "longtable"})});
+    for(const auto & xml : xmls)
+    {
+      scenes.push_back({xml, xml});
+    }
+  }
+
+  if(!hardware)
+  {
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+  }
+  if(!glfwInit())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLFW initialization failed");
+  }
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow * window =
+      glfwCreateWindow(resolutions[0].first, resolutions[0].second, "mc_mujoco benchmark", NULL, NULL);
+  if(!window)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLFW window creation failed");
+  }
+  glfwMakeContextCurrent(window);
+  mujoco_init_gl();
+  glfwSwapInterval(0);
+  mc_rtc::log::info("[mc_mujoco] OpenGL renderer: {}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+  ImGui::CreateContext();
+  ImPlot::CreateContext();
+  ImGui::GetIO().IniFilename = nullptr;
+  ImGui_ImplGlfw_InitForOpenGL(window, false);
+  ImGui_ImplOpenGL3_Init("#version 130");
+
+  std::ofstream csv_out;
+  if(csv.size())
+  {
+    csv_out.open(csv);
+    csv_out << "scene,width,height,setting";
+    for(auto phase : PHASES)
+    {
+      csv_out << "," << MjRenderProfiler::name(phase);
+    }
+    csv_out << ",total\n";
+  }
+  fmt::print("{:<24} {:>10} {:<24}", "scene", "resolution", "setting");
+  for(auto phase : PHASES)
+  {
+    fmt::print(" {:>14}", MjRenderProfiler::name(phase));
+  }
+  fmt::print(" {:>8} {:>8}\n", "total", "fps");
+
+  for(const auto & s : scenes)
+  {
+    char error[1024] = {0};
+    mjModel * model = mj_loadXML(s.xml.c_str(), nullptr, error, sizeof(error));
+    if(!model)
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to load {}: {}", s.xml, error);
+      continue;
+    }
+    mjData * data = mj_makeData(model);
+    Trace trace;
+    if(trace_path.size())
+    {
+      trace = read_trace(trace_path, model->nq);
+    }
+    if(trace.empty())
+    {
+      trace = make_trace(model, data, warmup + frames);
+    }
+    if(record_trace.size())
+    {
+      write_trace(fmt::format("{}_{}.txt", record_trace, s.name), trace);
+    }
+    MjMeshLOD lod;
+    lod.load(*model);
+
+    mjvCamera camera;
+    mjvOption options;
+    mjvPerturb pert;
+    mjvScene scene;
+    mjrContext context;
+    mjv_defaultCamera(&camera);
+    camera.lookat[2] = 0.5;
+    camera.distance = 4.0;
+    camera.azimuth = -150.0;
+    camera.elevation = -20.0;
+    mjv_defaultPerturb(&pert);
+    mjv_defaultScene(&scene);
+    mjr_defaultContext(&context);
+    mjv_makeScene(model, &scene, model->ngeom + 1000);
+    mjr_makeContext(model, &context, mjFONTSCALE_150);
+
+    BatchRenderer batch;
+    MjRenderProfiler profiler;
+    std::vector<std::vector<Eigen::Vector3d>> paths(model->nbody);
+    for(const auto & resolution : resolutions)
+    {
+      glfwSetWindowSize(window, resolution.first, resolution.second);
+      glfwPollEvents();
+      mjrRect rect = {0, 0, 0, 0};
+      glfwGetFramebufferSize(window, &rect.width, &rect.height);
+      for(const auto & setting : SETTINGS)
+      {
+        mjv_defaultOption(&options);
+        options.geomgroup[0] = setting.collisions;
+        options.flags[mjVIS_CONTACTPOINT] = setting.collisions;
+        options.flags[mjVIS_CONTACTFORCE] = setting.collisions;
+        for(auto & p : paths)
+        {
+          p.clear();
+        }
+        for(size_t i = 0; i < warmup + frames; ++i)
+        {
+          if(i == warmup)
+          {
+            profiler.reset();
+          }
+          const auto & qpos = trace[i % trace.size()];
+          mju_copy(data->qpos, qpos.data(), model->nq);
+          mj_forward(model, data);
+          for(int b = 1; b < model->nbody; ++b)
+          {
+            paths[b].push_back(Eigen::Map<const Eigen::Vector3d>(data->xpos + 3 * b));
+            if(paths[b].size() > 500)
+            {
+              paths[b].erase(paths[b].begin());
+            }
+          }
+
+          profiler.start();
+          mjv_updateScene(model, data, &options, &pert, &camera, mjCAT_ALL, &scene);
+          lod.filter(*model, scene, rect.height);
+          profiler.mark(MjRenderProfiler::Scene);
+          scene.flags[mjRND_SHADOW] = setting.shadows;
+          scene.flags[mjRND_REFLECTION] = setting.reflections;
+          scene.flags[mjRND_SKYBOX] = setting.skybox;
+          mjr_render(rect, &scene, &context);
+          // GL calls are queued, wait for each phase to be rasterized before it is timed
+          glFinish();
+          profiler.mark(MjRenderProfiler::Render);
+
+          std::array<float, 16> view;
+          std::array<float, 16> projection;
+          glGetFloatv(GL_MODELVIEW_MATRIX, view.data());
+          glGetFloatv(GL_PROJECTION_MATRIX, projection.data());
+          batch.clear();
+          emit_gui(model, data, paths, batch);
+          profiler.mark(MjRenderProfiler::ClientUpdate);
+          batch.draw(view, projection);
+          glFinish();
+          profiler.mark(MjRenderProfiler::Draw3D);
+
+          ImGui_ImplOpenGL3_NewFrame();
+          ImGui_ImplGlfw_NewFrame();
+          ImGui::NewFrame();
+          draw_imgui(profiler, s.name);
+          ImGui::Render();
+          ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+          glFinish();
+          profiler.mark(MjRenderProfiler::ImGui);
+
+          glfwSwapBuffers(window);
+          glFinish();
+          profiler.mark(MjRenderProfiler::Swap);
+          profiler.end();
+        }
+
+        double total = 0.0;
+        fmt::print("{:<24} {:>10} {:<24}", s.name, fmt::format("{}x{}", rect.width, rect.height), setting.name);
+        for(auto phase : PHASES)
+        {
+          total += profiler.average(phase);
+          fmt::print(" {:>12.2f}ms", profiler.average(phase));
+        }
+        fmt::print(" {:>6.2f}ms {:>8.1f}\n", total, total > 0 ? 1000.0 / total : 0.0);
+        if(csv_out.is_open())
+        {
+          csv_out << s.name << "," << rect.width << "," << rect.height << "," << setting.name;
+          for(auto phase : PHASES)
+          {
+            csv_out << "," << profiler.average(phase);
+          }
+          csv_out << "," << total << "\n";
+        }
+      }
+    }
+
+    mjv_freeScene(&scene);
+    mjr_freeContext(&context);
+    mj_deleteData(data);
+    mj_deleteModel(model);
+  }
+
+  ImGui_ImplOpenGL3_Shutdown();
+  ImGui_ImplGlfw_Shutdown();
+  ImPlot::DestroyContext();
+  ImGui::DestroyContext();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
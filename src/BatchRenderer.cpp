@@ -0,0 +1,778 @@
+#include "BatchRenderer.h"
+
+#include <GL/glew.h>
+
+#include <mc_rtc/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Number of subdivisions around the axis of round primitives */
+constexpr int ROUND_SLICES = 16;
+/** Number of subdivisions along the axis of spheres */
+constexpr int SPHERE_STACKS = 10;
+
+constexpr double PI = 3.14159265358979323846;
+
+/** Attributes from this location are read once per instance */
+constexpr GLuint FIRST_INSTANCE_ATTRIBUTE = 2;
+
+/** Shapes are shaded by a directional light coming from above, this matches the shading of the vertex arrays */
+const char * SHAPE_VERTEX_SHADER = R"(#version 130
+in vec3 position;
+in vec3 normal;
+in vec3 rotation_x;
+in vec3 rotation_y;
+in vec3 rotation_z;
+in vec3 scale;
+in vec3 origin;
+in vec4 color;
+out vec4 frag_color;
+void main()
+{
+  mat3 R = mat3(rotation_x, rotation_y, rotation_z);
+  gl_Position = gl_ModelViewProjectionMatrix * vec4(origin + R * (scale * position), 1.0);
+  vec3 n = normalize(R * (normal / max(scale, vec3(1e-6))));
+  float shade = 0.5 + 0.5 * max(0.0, dot(n, normalize(vec3(0.3, 0.4, 1.0))));
+  frag_color = vec4(shade * color.rgb, color.a);
+}
+)";
+
+const char * LINE_VERTEX_SHADER = R"(#version 130
+in float t;
+in vec3 from;
+in vec3 to;
+in vec4 color;
+out vec4 frag_color;
+void main()
+{
+  gl_Position = gl_ModelViewProjectionMatrix * vec4(mix(from, to, t), 1.0);
+  frag_color = color;
+}
+)";
+
+const char * FRAGMENT_SHADER = R"(#version 130
+in vec4 frag_color;
+void main()
+{
+  gl_FragColor = frag_color;
+}
+)";
+
+inline uint8_t to_u8(double c) noexcept
+{
+  return static_cast<uint8_t>(std::lround(255.0 * std::clamp(c, 0.0, 1.0)));
+}
+
+inline void to_u8(const mc_rtc::gui::Color & color, uint8_t out[4]) noexcept
+{
+  out[0] = to_u8(color.r);
+  out[1] = to_u8(color.g);
+  out[2] = to_u8(color.b);
+  out[3] = to_u8(color.a);
+}
+
+inline const void * offset(size_t bytes) noexcept
+{
+  return reinterpret_cast<const void *>(bytes);
+}
+
+/** Add a quad (a, b, c, d in counter-clockwise order) as two triangles */
+void add_quad(std::vector<Eigen::Vector3f> & vertices,
+              std::vector<Eigen::Vector3f> & normals,
+              const std::array<Eigen::Vector3f, 4> & v,
+              const std::array<Eigen::Vector3f, 4> & n)
+{
+  for(size_t i : {0, 1, 2, 0, 2, 3})
+  {
+    vertices.push_back(v[i]);
+    normals.push_back(n[i]);
+  }
+}
+
+Eigen::Vector3f circle(int i) noexcept
+{
+  double theta = 2 * PI * i / ROUND_SLICES;
+  return {static_cast<float>(std::cos(theta)), static_cast<float>(std::sin(theta)), 0.0f};
+}
+
+GLuint compile_shader(GLenum type, const char * source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+  GLint ok = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  if(!ok)
+  {
+    char log[1024] = {0};
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    mc_rtc::log::error("[mc_mujoco] Failed to compile the GUI shader: {}", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+/** Link a program from a vertex shader and the common fragment shader, attributes are bound in the given order
+ *
+ * \returns 0 on failure
+ */
+GLuint link_program(const char * vertex_source, const std::vector<std::pair<GLuint, const char *>> & attributes)
+{
+  GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+  GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+  if(!vertex || !fragment)
+  {
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return 0;
+  }
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertex);
+  glAttachShader(program, fragment);
+  for(const auto & a : attributes)
+  {
+    glBindAttribLocation(program, a.first, a.second);
+  }
+  glLinkProgram(program);
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+  GLint ok = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &ok);
+  if(!ok)
+  {
+    char log[1024] = {0};
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    mc_rtc::log::error("[mc_mujoco] Failed to link the GUI shaders: {}", log);
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+/** Enable or disable vertex attributes, attributes from FIRST_INSTANCE_ATTRIBUTE advance once per instance */
+void set_attributes(std::initializer_list<GLuint> attributes, bool enable)
+{
+  for(GLuint i : attributes)
+  {
+    if(enable)
+    {
+      glEnableVertexAttribArray(i);
+    }
+    else
+    {
+      glDisableVertexAttribArray(i);
+    }
+    glVertexAttribDivisor(i, enable && i >= FIRST_INSTANCE_ATTRIBUTE ? 1 : 0);
+  }
+}
+
+} // namespace
+
+void BatchRenderer::Primitives::clear() noexcept
+{
+  for(auto & batch : lines)
+  {
+    batch.lines.clear();
+  }
+  for(auto & instances : shapes)
+  {
+    instances.clear();
+  }
+  meshes.clear();
+}
+
+void BatchRenderer::Primitives::append(const Primitives & other)
+{
+  for(const auto & batch : other.lines)
+  {
+    if(batch.lines.size())
+    {
+      auto & out = lines_with(batch.width);
+      out.insert(out.end(), batch.lines.begin(), batch.lines.end());
+    }
+  }
+  for(size_t i = 0; i < SHAPES; ++i)
+  {
+    shapes[i].insert(shapes[i].end(), other.shapes[i].begin(), other.shapes[i].end());
+  }
+  meshes.insert(meshes.end(), other.meshes.begin(), other.meshes.end());
+}
+
+std::vector<BatchRenderer::Line> & BatchRenderer::Primitives::lines_with(float width)
+{
+  for(auto & batch : lines)
+  {
+    if(batch.width == width)
+    {
+      return batch.lines;
+    }
+  }
+  lines.push_back({width, {}});
+  return lines.back().lines;
+}
+
+void BatchRenderer::clear() noexcept
+{
+  stream_.clear();
+  for(auto it = groups_.begin(); it != groups_.end();)
+  {
+    if(it->second.frame == frame_)
+    {
+      ++it;
+    }
+    else
+    {
+      it = groups_.erase(it);
+      repack_ = true;
+    }
+  }
+  drawn_.clear();
+  frame_++;
+  reused_ = 0;
+  regenerated_ = 0;
+}
+
+void BatchRenderer::line(const Eigen::Vector3d & from,
+                         const Eigen::Vector3d & to,
+                         const mc_rtc::gui::Color & color,
+                         float width)
+{
+  Line l;
+  Eigen::Map<Eigen::Vector3f>(l.from) = from.cast<float>();
+  Eigen::Map<Eigen::Vector3f>(l.to) = to.cast<float>();
+  to_u8(color, l.color);
+  target_->lines_with(width).push_back(l);
+}
+
+void BatchRenderer::box(const Eigen::Vector3d & center,
+                        const Eigen::Matrix3d & orientation,
+                        const Eigen::Vector3d & size,
+                        const mc_rtc::gui::Color & color)
+{
+  instance(Box, center, orientation.transpose(), size, color);
+}
+
+void BatchRenderer::sphere(const Eigen::Vector3d & center, double radius, const mc_rtc::gui::Color & color)
+{
+  instance(Sphere, center, Eigen::Matrix3d::Identity(), Eigen::Vector3d::Constant(radius), color);
+}
+
+void BatchRenderer::arrow(const Eigen::Vector3d & from,
+                          const Eigen::Vector3d & to,
+                          double shaft_diam,
+                          double head_diam,
+                          double head_len,
+                          const mc_rtc::gui::Color & color)
+{
+  Eigen::Vector3d dir = to - from;
+  double length = dir.norm();
+  if(length < 1e-9)
+  {
+    return;
+  }
+  Eigen::Matrix3d rotation = Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitZ(), dir).toRotationMatrix();
+  double head = head_diam > 0 && head_len > 0 ? std::min(head_len, length) : 0.0;
+  double shaft = length - head;
+  if(shaft > 0)
+  {
+    instance(Cylinder, from, rotation, {0.5 * shaft_diam, 0.5 * shaft_diam, shaft}, color);
+  }
+  if(head > 0)
+  {
+    Eigen::Vector3d head_start = from + (shaft / length) * dir;
+    instance(Cone, head_start, rotation, {0.5 * head_diam, 0.5 * head_diam, head}, color);
+  }
+}
+
+void BatchRenderer::mesh(const std::string & path,
+                         const sva::PTransformd & pos,
+                         const Eigen::Vector3d & scale,
+                         const mc_rtc::gui::Color & color)
+{
+  target_->meshes.push_back({});
+  auto & m = target_->meshes.back();
+  m.id = cache_.id(path);
+  m.transform.setIdentity();
+  m.transform.topLeftCorner<3, 3>() = pos.rotation().transpose() * scale.asDiagonal();
+  m.transform.topRightCorner<3, 1>() = pos.translation();
+  to_u8(color, m.color);
+}
+
+void BatchRenderer::instance(Shape shape,
+                             const Eigen::Vector3d & origin,
+                             const Eigen::Matrix3d & rotation,
+                             const Eigen::Vector3d & scale,
+                             const mc_rtc::gui::Color & color)
+{
+  Instance i;
+  Eigen::Map<Eigen::Matrix3f>(i.rotation) = rotation.cast<float>();
+  Eigen::Map<Eigen::Vector3f>(i.scale) = scale.cast<float>();
+  Eigen::Map<Eigen::Vector3f>(i.origin) = origin.cast<float>();
+  to_u8(color, i.color);
+  target_->shapes[shape].push_back(i);
+}
+
+void BatchRenderer::init_gl()
+{
+  gl_initialized_ = true;
+  instancing_ = GLEW_VERSION_3_3;
+  if(instancing_)
+  {
+    shape_program_ = link_program(SHAPE_VERTEX_SHADER, {{0, "position"},
+                                                        {1, "normal"},
+                                                        {2, "rotation_x"},
+                                                        {3, "rotation_y"},
+                                                        {4, "rotation_z"},
+                                                        {5, "scale"},
+                                                        {6, "origin"},
+                                                        {7, "color"}});
+    line_program_ = link_program(LINE_VERTEX_SHADER, {{0, "t"}, {2, "from"}, {3, "to"}, {4, "color"}});
+    instancing_ = shape_program_ != 0 && line_program_ != 0;
+  }
+  if(!instancing_)
+  {
+    mc_rtc::log::warning("[mc_mujoco] Instanced rendering is not available, the GUI is drawn from vertex arrays");
+    return;
+  }
+  glGenBuffers(static_cast<GLsizei>(SHAPES), unit_vbos_.data());
+  for(size_t i = 0; i < SHAPES; ++i)
+  {
+    const auto & mesh = unit(static_cast<Shape>(i));
+    std::vector<float> data;
+    data.reserve(6 * mesh.vertices.size());
+    for(size_t j = 0; j < mesh.vertices.size(); ++j)
+    {
+      data.insert(data.end(), mesh.vertices[j].data(), mesh.vertices[j].data() + 3);
+      data.insert(data.end(), mesh.normals[j].data(), mesh.normals[j].data() + 3);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, unit_vbos_[i]);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size() * sizeof(float)), data.data(), GL_STATIC_DRAW);
+  }
+  const float segment[2] = {0.0f, 1.0f};
+  glGenBuffers(1, &segment_vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, segment_vbo_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(segment), segment, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BatchRenderer::upload(const Primitives & primitives, Buffers & buffers, bool stream)
+{
+  buffers.lines.clear();
+  size_t nlines = 0;
+  for(const auto & batch : primitives.lines)
+  {
+    if(batch.lines.size())
+    {
+      buffers.lines.push_back({batch.width, nlines, batch.lines.size()});
+      nlines += batch.lines.size();
+    }
+  }
+  size_t ninstances = 0;
+  for(size_t i = 0; i < SHAPES; ++i)
+  {
+    buffers.shapes[i] = {ninstances, primitives.shapes[i].size()};
+    ninstances += primitives.shapes[i].size();
+  }
+  if(!instancing_)
+  {
+    // Simple directional light coming from above, the arrays are drawn without OpenGL lighting
+    static const Eigen::Vector3f light = Eigen::Vector3f(0.3f, 0.4f, 1.0f).normalized();
+    buffers.line_vertices.clear();
+    for(const auto & batch : primitives.lines)
+    {
+      for(const auto & l : batch.lines)
+      {
+        Vertex v;
+        std::copy(l.color, l.color + 4, v.color);
+        for(const float * p : {l.from, l.to})
+        {
+          std::copy(p, p + 3, v.pos);
+          buffers.line_vertices.push_back(v);
+        }
+      }
+    }
+    buffers.triangles.clear();
+    for(size_t s = 0; s < SHAPES; ++s)
+    {
+      const auto & mesh = unit(static_cast<Shape>(s));
+      for(const auto & i : primitives.shapes[s])
+      {
+        Eigen::Map<const Eigen::Matrix3f> R(i.rotation);
+        Eigen::Map<const Eigen::Vector3f> scale(i.scale);
+        Eigen::Map<const Eigen::Vector3f> origin(i.origin);
+        Eigen::Vector3f inv_scale = scale.cwiseMax(1e-6f).cwiseInverse();
+        Vertex v;
+        v.color[3] = i.color[3];
+        for(size_t j = 0; j < mesh.vertices.size(); ++j)
+        {
+          Eigen::Map<Eigen::Vector3f>(v.pos) = origin + R * scale.cwiseProduct(mesh.vertices[j]);
+          Eigen::Vector3f n = (R * inv_scale.cwiseProduct(mesh.normals[j])).normalized();
+          float shade = 0.5f + 0.5f * std::max(0.0f, n.dot(light));
+          for(size_t c = 0; c < 3; ++c)
+          {
+            v.color[c] = static_cast<uint8_t>(std::lround(shade * i.color[c]));
+          }
+          buffers.triangles.push_back(v);
+        }
+      }
+    }
+    return;
+  }
+  GLenum usage = stream ? GL_STREAM_DRAW : GL_STATIC_DRAW;
+  if(buffers.line_vbo == 0)
+  {
+    glGenBuffers(1, &buffers.line_vbo);
+    glGenBuffers(1, &buffers.shape_vbo);
+  }
+  if(nlines)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.line_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(nlines * sizeof(Line)), nullptr, usage);
+    size_t first = 0;
+    for(const auto & batch : primitives.lines)
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(Line)),
+                      static_cast<GLsizeiptr>(batch.lines.size() * sizeof(Line)), batch.lines.data());
+      first += batch.lines.size();
+    }
+  }
+  if(ninstances)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.shape_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ninstances * sizeof(Instance)), nullptr, usage);
+    for(size_t i = 0; i < SHAPES; ++i)
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(buffers.shapes[i].first * sizeof(Instance)),
+                      static_cast<GLsizeiptr>(buffers.shapes[i].second * sizeof(Instance)),
+                      primitives.shapes[i].data());
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BatchRenderer::draw_shapes(const Buffers & buffers)
+{
+  if(!instancing_)
+  {
+    if(buffers.triangles.size())
+    {
+      glVertexPointer(3, GL_FLOAT, sizeof(Vertex), buffers.triangles[0].pos);
+      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), buffers.triangles[0].color);
+      glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(buffers.triangles.size()));
+    }
+    return;
+  }
+  for(size_t s = 0; s < SHAPES; ++s)
+  {
+    size_t first = buffers.shapes[s].first;
+    size_t count = buffers.shapes[s].second;
+    if(count == 0)
+    {
+      continue;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, unit_vbos_[s]);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), offset(0));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), offset(3 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.shape_vbo);
+    size_t base = first * sizeof(Instance);
+    for(GLuint c = 0; c < 3; ++c)
+    {
+      glVertexAttribPointer(2 + c, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                            offset(base + offsetof(Instance, rotation) + 3 * c * sizeof(float)));
+    }
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), offset(base + offsetof(Instance, scale)));
+    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), offset(base + offsetof(Instance, origin)));
+    glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), offset(base + offsetof(Instance, color)));
+    glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(unit(static_cast<Shape>(s)).vertices.size()),
+                          static_cast<GLsizei>(count));
+  }
+}
+
+void BatchRenderer::draw_lines(const Buffers & buffers)
+{
+  auto width = [this](float w) { return thin_lines ? 1.0f : std::max(1.0f, w * line_width); };
+  if(!instancing_)
+  {
+    if(buffers.line_vertices.empty())
+    {
+      return;
+    }
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), buffers.line_vertices[0].pos);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), buffers.line_vertices[0].color);
+    for(const auto & range : buffers.lines)
+    {
+      glLineWidth(width(range.width));
+      glDrawArrays(GL_LINES, static_cast<GLint>(2 * range.first), static_cast<GLsizei>(2 * range.count));
+    }
+    return;
+  }
+  if(buffers.lines.empty())
+  {
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, segment_vbo_);
+  glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), offset(0));
+  glBindBuffer(GL_ARRAY_BUFFER, buffers.line_vbo);
+  for(const auto & range : buffers.lines)
+  {
+    size_t base = range.first * sizeof(Line);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Line), offset(base + offsetof(Line, from)));
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Line), offset(base + offsetof(Line, to)));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Line), offset(base + offsetof(Line, color)));
+    glLineWidth(width(range.width));
+    glDrawArraysInstanced(GL_LINES, 0, 2, static_cast<GLsizei>(range.count));
+  }
+}
+
+void BatchRenderer::draw_meshes(const std::vector<MeshInstance> & meshes)
+{
+  for(const auto & m : meshes)
+  {
+    if(!cache_.ready(m.id))
+    {
+      continue;
+    }
+    glColor4ubv(m.color);
+    glPushMatrix();
+    glMultMatrixd(m.transform.data());
+    cache_.draw(m.id);
+    glPopMatrix();
+  }
+}
+
+void BatchRenderer::draw(const std::array<float, 16> & view, const std::array<float, 16> & projection)
+{
+  cache_.upload();
+  if(!gl_initialized_)
+  {
+    init_gl();
+  }
+  // Group the mesh instances to bind each buffer once
+  auto sort_meshes = [](std::vector<MeshInstance> & meshes) {
+    std::sort(meshes.begin(), meshes.end(),
+              [](const MeshInstance & lhs, const MeshInstance & rhs) { return lhs.id < rhs.id; });
+  };
+  if(repack_ || drawn_ != packed_)
+  {
+    cached_.clear();
+    for(const auto * group : drawn_)
+    {
+      cached_.append(group->primitives);
+    }
+    sort_meshes(cached_.meshes);
+    upload(cached_, cached_buffers_, false);
+    packed_ = drawn_;
+    repack_ = false;
+  }
+  sort_meshes(stream_.meshes);
+  upload(stream_, stream_buffers_, true);
+
+  lines_ = 0;
+  triangles_ = 0;
+  for(const auto * p : {&cached_, &stream_})
+  {
+    for(const auto & batch : p->lines)
+    {
+      lines_ += batch.lines.size();
+    }
+    for(size_t s = 0; s < SHAPES; ++s)
+    {
+      triangles_ += p->shapes[s].size() * unit(static_cast<Shape>(s)).vertices.size() / 3;
+    }
+  }
+  meshes_ = cached_.meshes.size() + stream_.meshes.size();
+  if(lines_ == 0 && triangles_ == 0 && meshes_ == 0)
+  {
+    return;
+  }
+
+  glPushAttrib(GL_ENABLE_BIT | GL_LINE_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_LIGHTING_BIT
+               | GL_CURRENT_BIT);
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+  // Client-side arrays are read from memory only if no vertex buffer is bound
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadMatrixf(projection.data());
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadMatrixf(view.data());
+
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glDisable(GL_CULL_FACE);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LEQUAL);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  if(instancing_)
+  {
+    glUseProgram(shape_program_);
+    set_attributes({0, 1, 2, 3, 4, 5, 6, 7}, true);
+    draw_shapes(cached_buffers_);
+    draw_shapes(stream_buffers_);
+    set_attributes({0, 1, 2, 3, 4, 5, 6, 7}, false);
+    glUseProgram(line_program_);
+    set_attributes({0, 2, 3, 4}, true);
+    draw_lines(cached_buffers_);
+    draw_lines(stream_buffers_);
+    set_attributes({0, 2, 3, 4}, false);
+    glUseProgram(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  else
+  {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    draw_shapes(cached_buffers_);
+    draw_shapes(stream_buffers_);
+    draw_lines(cached_buffers_);
+    draw_lines(stream_buffers_);
+    glDisableClientState(GL_COLOR_ARRAY);
+  }
+
+  if(meshes_)
+  {
+    // Meshes are lit by a white headlight, the light position is given in eye coordinates
+    static const GLfloat light_pos[] = {0.0f, 0.0f, 1.0f, 0.0f};
+    static const GLfloat light_ambient[] = {0.4f, 0.4f, 0.4f, 1.0f};
+    static const GLfloat light_diffuse[] = {0.6f, 0.6f, 0.6f, 1.0f};
+    glPushMatrix();
+    glLoadIdentity();
+    glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
+    glPopMatrix();
+    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+    for(GLenum light = GL_LIGHT1; light <= GL_LIGHT7; ++light)
+    {
+      glDisable(light);
+    }
+    glEnable(GL_LIGHT0);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    draw_meshes(cached_.meshes);
+    draw_meshes(stream_.meshes);
+  }
+
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+  glPopClientAttrib();
+  glPopAttrib();
+}
+
+const BatchRenderer::Mesh & BatchRenderer::unit(Shape shape)
+{
+  switch(shape)
+  {
+    case Box:
+      return unit_box();
+    case Sphere:
+      return unit_sphere();
+    case Cylinder:
+      return unit_cylinder();
+    default:
+      return unit_cone();
+  }
+}
+
+const BatchRenderer::Mesh & BatchRenderer::unit_box()
+{
+  static const Mesh mesh = []() {
+    Mesh out;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      for(float sign : {-1.0f, 1.0f})
+      {
+        Eigen::Vector3f n = Eigen::Vector3f::Zero();
+        n[axis] = sign;
+        Eigen::Vector3f u = Eigen::Vector3f::Zero();
+        u[(axis + 1) % 3] = 1.0f;
+        Eigen::Vector3f w = sign * n.cross(u);
+        add_quad(out.vertices, out.normals, {n - u - w, n + u - w, n + u + w, n - u + w}, {n, n, n, n});
+      }
+    }
+    return out;
+  }();
+  return mesh;
+}
+
+const BatchRenderer::Mesh & BatchRenderer::unit_sphere()
+{
+  static const Mesh mesh = []() {
+    Mesh out;
+    auto point = [](int stack, int slice) -> Eigen::Vector3f {
+      double phi = PI * stack / SPHERE_STACKS - PI / 2;
+      return static_cast<float>(std::cos(phi)) * circle(slice)
+             + Eigen::Vector3f(0.0f, 0.0f, static_cast<float>(std::sin(phi)));
+    };
+    for(int i = 0; i < SPHERE_STACKS; ++i)
+    {
+      for(int j = 0; j < ROUND_SLICES; ++j)
+      {
+        std::array<Eigen::Vector3f, 4> v = {point(i, j), point(i, j + 1), point(i + 1, j + 1), point(i + 1, j)};
+        add_quad(out.vertices, out.normals, v, v);
+      }
+    }
+    return out;
+  }();
+  return mesh;
+}
+
+const BatchRenderer::Mesh & BatchRenderer::unit_cylinder()
+{
+  static const Mesh mesh = []() {
+    Mesh out;
+    Eigen::Vector3f top = Eigen::Vector3f::UnitZ();
+    for(int j = 0; j < ROUND_SLICES; ++j)
+    {
+      Eigen::Vector3f c0 = circle(j);
+      Eigen::Vector3f c1 = circle(j + 1);
+      add_quad(out.vertices, out.normals, {c0, c1, c1 + top, c0 + top}, {c0, c1, c1, c0});
+      out.vertices.insert(out.vertices.end(), {Eigen::Vector3f::Zero(), c1, c0});
+      out.normals.insert(out.normals.end(), {-top, -top, -top});
+      out.vertices.insert(out.vertices.end(), {top, c0 + top, c1 + top});
+      out.normals.insert(out.normals.end(), {top, top, top});
+    }
+    return out;
+  }();
+  return mesh;
+}
+
+const BatchRenderer::Mesh & BatchRenderer::unit_cone()
+{
+  static const Mesh mesh = []() {
+    Mesh out;
+    Eigen::Vector3f top = Eigen::Vector3f::UnitZ();
+    for(int j = 0; j < ROUND_SLICES; ++j)
+    {
+      Eigen::Vector3f c0 = circle(j);
+      Eigen::Vector3f c1 = circle(j + 1);
+      Eigen::Vector3f n0 = (c0 + top).normalized();
+      Eigen::Vector3f n1 = (c1 + top).normalized();
+      out.vertices.insert(out.vertices.end(), {c0, c1, top});
+      out.normals.insert(out.normals.end(), {n0, n1, (n0 + n1).normalized()});
+      out.vertices.insert(out.vertices.end(), {Eigen::Vector3f::Zero(), c1, c0});
+      out.normals.insert(out.normals.end(), {-top, -top, -top});
+    }
+    return out;
+  }();
+  return mesh;
+}
+
+} // namespace mc_mujoco
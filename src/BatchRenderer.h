@@ -0,0 +1,311 @@
+#pragma once
+
+#include "MeshCache.h"
+
+#include <mc_rtc/gui/types.h>
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Draws the 3D elements of the mc_rtc GUI on top of the MuJoCo scene
+ *
+ * Lines, boxes, spheres, cylinders and cones are recorded as instances (the end points of a line or the placement of a
+ * unit shape, and a color) and drawn after mjr_render with one instanced draw call per shape and per line width. This
+ * keeps the scene's geometry budget for the model. Without instancing (OpenGL < 3.3) the instances are expanded into
+ * vertex arrays on the CPU.
+ *
+ * The instances of cached elements are packed in their own buffers, these are only rebuilt when a cached element is
+ * generated again or when the set of drawn elements changes.
+ *
+ * Meshes are drawn from the GPU buffers of a MeshCache, one draw call per instance.
+ */
+struct BatchRenderer
+{
+  /** Remove every primitive from the batch, cached elements that were not drawn since the last clear are forgotten */
+  void clear() noexcept;
+
+  /** Draw the primitives emitted by \p emit for the element identified by \p key
+   *
+   * The primitives are kept and re-used as long as the element is drawn every frame with the same \p version, in that
+   * case \p emit is not called
+   */
+  template<typename EmitT>
+  void cached(const void * key, uint64_t version, EmitT && emit)
+  {
+    auto & group = groups_[key];
+    group.frame = frame_;
+    drawn_.push_back(&group);
+    if(group.valid && group.version == version)
+    {
+      reused_++;
+      return;
+    }
+    group.primitives.clear();
+    target_ = &group.primitives;
+    emit();
+    target_ = &stream_;
+    group.version = version;
+    group.valid = true;
+    repack_ = true;
+    regenerated_++;
+  }
+
+  /** Draw a line, \p width is relative to line_width */
+  void line(const Eigen::Vector3d & from,
+            const Eigen::Vector3d & to,
+            const mc_rtc::gui::Color & color,
+            float width = 1.0f);
+
+  /** Draw a box, size holds the half-extents along each axis of orientation (same convention as mc_rtc rotations) */
+  void box(const Eigen::Vector3d & center,
+           const Eigen::Matrix3d & orientation,
+           const Eigen::Vector3d & size,
+           const mc_rtc::gui::Color & color);
+
+  void sphere(const Eigen::Vector3d & center, double radius, const mc_rtc::gui::Color & color);
+
+  /** Draw an arrow from \p from to \p to, a null head length or diameter draws a cylinder */
+  void arrow(const Eigen::Vector3d & from,
+             const Eigen::Vector3d & to,
+             double shaft_diam,
+             double head_diam,
+             double head_len,
+             const mc_rtc::gui::Color & color);
+
+  /** Keep the primitives of a cached element that is not drawn in this batch */
+  inline void retain(const void * key) noexcept
+  {
+    auto it = groups_.find(key);
+    if(it != groups_.end())
+    {
+      it->second.frame = frame_;
+    }
+  }
+
+  /** Radius of the mesh at \p path around its origin (before scaling), negative until the mesh has been loaded */
+  inline double mesh_radius(const std::string & path)
+  {
+    return cache_.radius(cache_.id(path));
+  }
+
+  /** Draw the mesh at \p path with the given pose and scale, nothing is drawn until the mesh has been loaded */
+  void mesh(const std::string & path,
+            const sva::PTransformd & pos,
+            const Eigen::Vector3d & scale,
+            const mc_rtc::gui::Color & color);
+
+  /** Draw the batch with the provided view and projection matrices, the caller's GL state is preserved */
+  void draw(const std::array<float, 16> & view, const std::array<float, 16> & projection);
+
+  /** Number of lines in the last drawn batch */
+  inline size_t lines() const noexcept
+  {
+    return lines_;
+  }
+
+  /** Number of triangles in the last drawn batch */
+  inline size_t triangles() const noexcept
+  {
+    return triangles_;
+  }
+
+  /** Number of meshes in the last drawn batch */
+  inline size_t meshes() const noexcept
+  {
+    return meshes_;
+  }
+
+  /** Number of cached elements re-used in this batch */
+  inline size_t reused() const noexcept
+  {
+    return reused_;
+  }
+
+  /** Number of cached elements generated again in this batch */
+  inline size_t regenerated() const noexcept
+  {
+    return regenerated_;
+  }
+
+  /** Width of the lines in pixels */
+  float line_width = 2.0f;
+
+  /** If true, lines are drawn one pixel wide regardless of line_width */
+  bool thin_lines = false;
+
+private:
+  /** Unit shapes drawn by instancing */
+  enum Shape
+  {
+    Box = 0,
+    Sphere,
+    Cylinder,
+    Cone
+  };
+  static constexpr size_t SHAPES = 4;
+
+  struct Line
+  {
+    float from[3];
+    float to[3];
+    uint8_t color[4];
+  };
+
+  /** Lines drawn with the same width */
+  struct LineBatch
+  {
+    /** Width relative to line_width */
+    float width;
+    std::vector<Line> lines;
+  };
+
+  /** Unit shape scaled, rotated and translated */
+  struct Instance
+  {
+    /** Columns of the rotation from the shape frame to the world frame */
+    float rotation[9];
+    float scale[3];
+    float origin[3];
+    uint8_t color[4];
+  };
+
+  struct MeshInstance
+  {
+    /** Mesh in the cache */
+    size_t id;
+    /** Model matrix (column-major) */
+    Eigen::Matrix4d transform;
+    uint8_t color[4];
+  };
+
+  /** Primitives of a batch or of a cached element */
+  struct Primitives
+  {
+    std::vector<LineBatch> lines;
+    std::array<std::vector<Instance>, SHAPES> shapes;
+    std::vector<MeshInstance> meshes;
+
+    /** Remove every primitive, the memory is kept */
+    void clear() noexcept;
+
+    /** Add the primitives of other */
+    void append(const Primitives & other);
+
+    /** Lines drawn with the given width */
+    std::vector<Line> & lines_with(float width);
+  };
+
+  /** Primitives that are not part of a cached element */
+  Primitives stream_;
+  /** Primitives of the cached elements drawn in the last batch */
+  Primitives cached_;
+  /** Where new primitives are recorded */
+  Primitives * target_ = &stream_;
+
+  /** Primitives of a cached element */
+  struct Group
+  {
+    uint64_t version = 0;
+    bool valid = false;
+    /** Last batch where the element was drawn */
+    uint64_t frame = 0;
+    Primitives primitives;
+  };
+  std::unordered_map<const void *, Group> groups_;
+  /** Cached elements drawn in this batch in drawing order */
+  std::vector<const Group *> drawn_;
+  /** Cached elements packed in cached_ */
+  std::vector<const Group *> packed_;
+  /** True if a cached element was generated or forgotten since cached_ was packed */
+  bool repack_ = false;
+  /** Incremented by clear */
+  uint64_t frame_ = 0;
+  size_t reused_ = 0;
+  size_t regenerated_ = 0;
+  size_t lines_ = 0;
+  size_t triangles_ = 0;
+  size_t meshes_ = 0;
+
+  MeshCache cache_;
+
+  /** Vertex of the arrays drawn without instancing */
+  struct Vertex
+  {
+    float pos[3];
+    uint8_t color[4];
+  };
+
+  /** Primitives ready to be drawn: GPU buffers with instancing, vertex arrays in memory otherwise */
+  struct Buffers
+  {
+    /** Width, first line and number of lines of each non-empty line batch */
+    struct LineRange
+    {
+      float width;
+      size_t first;
+      size_t count;
+    };
+    std::vector<LineRange> lines;
+    /** First instance and number of instances of each shape */
+    std::array<std::pair<size_t, size_t>, SHAPES> shapes;
+    /** Line and shape instances */
+    unsigned int line_vbo = 0;
+    unsigned int shape_vbo = 0;
+    /** Line vertices (two per line) and shape triangles without instancing */
+    std::vector<Vertex> line_vertices;
+    std::vector<Vertex> triangles;
+  };
+  Buffers stream_buffers_;
+  Buffers cached_buffers_;
+
+  /** OpenGL objects are created on the first draw, buffers are released with the OpenGL context */
+  bool gl_initialized_ = false;
+  bool instancing_ = false;
+  unsigned int shape_program_ = 0;
+  unsigned int line_program_ = 0;
+  /** Interleaved position and normal of the unit shapes */
+  std::array<unsigned int, SHAPES> unit_vbos_ = {};
+  /** Parameter along a line of its two vertices */
+  unsigned int segment_vbo_ = 0;
+
+  void init_gl();
+
+  /** Prepare primitives to be drawn, stream is true if they are only drawn once */
+  void upload(const Primitives & primitives, Buffers & buffers, bool stream);
+
+  void draw_shapes(const Buffers & buffers);
+
+  void draw_lines(const Buffers & buffers);
+
+  void draw_meshes(const std::vector<MeshInstance> & meshes);
+
+  /** Record a unit shape scaled, rotated (local to world) and translated */
+  void instance(Shape shape,
+                const Eigen::Vector3d & origin,
+                const Eigen::Matrix3d & rotation,
+                const Eigen::Vector3d & scale,
+                const mc_rtc::gui::Color & color);
+
+  /** Unit mesh, one position and normal per triangle vertex */
+  struct Mesh
+  {
+    std::vector<Eigen::Vector3f> vertices;
+    std::vector<Eigen::Vector3f> normals;
+  };
+
+  static const Mesh & unit(Shape shape);
+  static const Mesh & unit_box();
+  static const Mesh & unit_sphere();
+  static const Mesh & unit_cylinder();
+  static const Mesh & unit_cone();
+};
+
+} // namespace mc_mujoco
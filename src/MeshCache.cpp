@@ -0,0 +1,278 @@
+#include "MeshCache.h"
+
+#include <GL/glew.h>
+
+#include <mc_rtc/logging.h>
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Append a triangle and its normal to the interleaved vertex data */
+void add_triangle(std::vector<float> & out,
+                  const Eigen::Vector3f & a,
+                  const Eigen::Vector3f & b,
+                  const Eigen::Vector3f & c)
+{
+  Eigen::Vector3f n = (b - a).cross(c - a);
+  if(n.norm() > 0)
+  {
+    n.normalize();
+  }
+  for(const auto & v : {a, b, c})
+  {
+    out.insert(out.end(), {v.x(), v.y(), v.z(), n.x(), n.y(), n.z()});
+  }
+}
+
+bool parse_stl(const std::string & path, std::vector<float> & out)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  if(!ifs.is_open())
+  {
+    return false;
+  }
+  std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  uint32_t ntriangles = 0;
+  if(content.size() >= 84)
+  {
+    std::memcpy(&ntriangles, content.data() + 80, sizeof(uint32_t));
+  }
+  if(content.size() >= 84 && content.size() == 84 + 50 * static_cast<size_t>(ntriangles))
+  {
+    out.reserve(18 * ntriangles);
+    for(size_t i = 0; i < ntriangles; ++i)
+    {
+      // Skip the stored normal, some exporters leave it empty
+      float v[9];
+      std::memcpy(v, content.data() + 84 + 50 * i + 12, sizeof(v));
+      add_triangle(out, {v[0], v[1], v[2]}, {v[3], v[4], v[5]}, {v[6], v[7], v[8]});
+    }
+    return true;
+  }
+  std::istringstream iss(content);
+  std::string token;
+  std::vector<Eigen::Vector3f> facet;
+  while(iss >> token)
+  {
+    if(token != "vertex")
+    {
+      continue;
+    }
+    Eigen::Vector3f v;
+    iss >> v.x() >> v.y() >> v.z();
+    facet.push_back(v);
+    if(facet.size() == 3)
+    {
+      add_triangle(out, facet[0], facet[1], facet[2]);
+      facet.clear();
+    }
+  }
+  return out.size() != 0;
+}
+
+bool parse_obj(const std::string & path, std::vector<float> & out)
+{
+  std::ifstream ifs(path);
+  if(!ifs.is_open())
+  {
+    return false;
+  }
+  std::vector<Eigen::Vector3f> vertices;
+  std::vector<size_t> face;
+  std::string line;
+  std::string token;
+  while(std::getline(ifs, line))
+  {
+    std::istringstream iss(line);
+    if(!(iss >> token))
+    {
+      continue;
+    }
+    if(token == "v")
+    {
+      Eigen::Vector3f v;
+      iss >> v.x() >> v.y() >> v.z();
+      vertices.push_back(v);
+    }
+    else if(token == "f")
+    {
+      face.clear();
+      while(iss >> token)
+      {
+        // Faces are written as v, v/vt, v//vn or v/vt/vn, negative indices are relative to the end
+        long idx = 0;
+        try
+        {
+          idx = std::stol(token.substr(0, token.find('/')));
+        }
+        catch(const std::logic_error &)
+        {
+          return false;
+        }
+        idx = idx < 0 ? static_cast<long>(vertices.size()) + idx : idx - 1;
+        if(idx < 0 || static_cast<size_t>(idx) >= vertices.size())
+        {
+          return false;
+        }
+        face.push_back(static_cast<size_t>(idx));
+      }
+      for(size_t i = 2; i < face.size(); ++i)
+      {
+        add_triangle(out, vertices[face[0]], vertices[face[i - 1]], vertices[face[i]]);
+      }
+    }
+  }
+  return out.size() != 0;
+}
+
+} // namespace
+
+bool load_mesh(const std::string & path, std::vector<float> & data)
+{
+  auto ext = boost::algorithm::to_lower_copy(bfs::path(path).extension().string());
+  if(ext == ".stl")
+  {
+    return parse_stl(path, data);
+  }
+  if(ext == ".obj")
+  {
+    return parse_obj(path, data);
+  }
+  return false;
+}
+
+MeshCache::MeshCache() : thread_([this]() { run(); }) {}
+
+MeshCache::~MeshCache()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+size_t MeshCache::id(const std::string & path)
+{
+  auto it = ids_.find(path);
+  if(it != ids_.end())
+  {
+    return it->second;
+  }
+  size_t id = entries_.size();
+  entries_.push_back(std::make_unique<Entry>());
+  entries_.back()->path = path;
+  ids_[path] = id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(entries_.back().get());
+  }
+  cv_.notify_one();
+  return id;
+}
+
+void MeshCache::upload()
+{
+  std::vector<Entry *> parsed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(parsed_.empty())
+    {
+      return;
+    }
+    std::swap(parsed, parsed_);
+  }
+  for(auto * entry : parsed)
+  {
+    glGenBuffers(1, &entry->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, entry->vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(entry->data.size() * sizeof(float)), entry->data.data(),
+                 GL_STATIC_DRAW);
+    entry->count = static_cast<int>(entry->data.size() / 6);
+    float r2 = 0.0f;
+    for(size_t i = 0; i < entry->data.size(); i += 6)
+    {
+      r2 = std::max(r2, Eigen::Map<const Eigen::Vector3f>(&entry->data[i]).squaredNorm());
+    }
+    entry->radius = std::sqrt(r2);
+    entry->data = {};
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool MeshCache::ready(size_t id) const noexcept
+{
+  return entries_[id]->vbo != 0;
+}
+
+float MeshCache::radius(size_t id) const noexcept
+{
+  return entries_[id]->radius;
+}
+
+void MeshCache::draw(size_t id) const
+{
+  const auto & entry = *entries_[id];
+  glBindBuffer(GL_ARRAY_BUFFER, entry.vbo);
+  glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), nullptr);
+  glNormalPointer(GL_FLOAT, 6 * sizeof(float), reinterpret_cast<const void *>(3 * sizeof(float)));
+  glDrawArrays(GL_TRIANGLES, 0, entry.count);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshCache::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true)
+  {
+    cv_.wait(lock, [this]() { return queue_.size() || stop_; });
+    if(stop_)
+    {
+      return;
+    }
+    auto * entry = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+    auto path = entry->path;
+    if(boost::algorithm::starts_with(path, "file://"))
+    {
+      path = path.substr(7);
+    }
+    auto ext = boost::algorithm::to_lower_copy(bfs::path(path).extension().string());
+    std::vector<float> data;
+    bool ok = load_mesh(path, data);
+    if(ext != ".stl" && ext != ".obj")
+    {
+      mc_rtc::log::warning("[mc_mujoco] Cannot display {}, only STL and OBJ meshes are supported", entry->path);
+    }
+    else if(!ok)
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to load mesh {}", entry->path);
+    }
+    lock.lock();
+    if(ok)
+    {
+      entry->data = std::move(data);
+      parsed_.push_back(entry);
+    }
+  }
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Load the triangles of an STL or OBJ mesh as interleaved position and normal (6 floats per vertex)
+ *
+ * \returns False if the file cannot be read or the format is not supported
+ */
+bool load_mesh(const std::string & path, std::vector<float> & data);
+
+/** Cache of the meshes displayed by the GUI
+ *
+ * Each file is parsed once in a background thread (STL and OBJ are supported) then uploaded once to a GPU vertex
+ * buffer by the rendering thread. Buffers are released with the OpenGL context.
+ */
+struct MeshCache
+{
+  MeshCache();
+
+  ~MeshCache();
+
+  MeshCache(const MeshCache &) = delete;
+  MeshCache & operator=(const MeshCache &) = delete;
+
+  /** Index of the mesh loaded from path, loading starts on the first call for a given path */
+  size_t id(const std::string & path);
+
+  /** Upload the meshes parsed since the last call, must be called with the OpenGL context current */
+  void upload();
+
+  /** True if the mesh is ready to be drawn */
+  bool ready(size_t id) const noexcept;
+
+  /** Largest distance between the origin of the mesh and its vertices, negative until the mesh is uploaded */
+  float radius(size_t id) const noexcept;
+
+  /** Draw the mesh with the current transformation, the vertex and normal arrays must be enabled */
+  void draw(size_t id) const;
+
+private:
+  struct Entry
+  {
+    std::string path;
+    /** Interleaved position and normal of each triangle vertex, released after the upload */
+    std::vector<float> data;
+    /** Vertex buffer, only accessed by the rendering thread */
+    unsigned int vbo = 0;
+    /** Number of vertices in the buffer */
+    int count = 0;
+    /** See radius */
+    float radius = -1.0f;
+  };
+  /** Entries are only created by the rendering thread, the loader accesses them through the queues */
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::unordered_map<std::string, size_t> ids_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  /** Entries waiting to be parsed */
+  std::deque<Entry *> queue_;
+  /** Entries parsed and waiting to be uploaded */
+  std::vector<Entry *> parsed_;
+  bool stop_ = false;
+  /** Declared last so that it starts after the other members are initialized */
+  std::thread thread_;
+
+  void run();
+};
+
+} // namespace mc_mujoco
@@ -28,12 +28,6 @@ inline ImU32 to_imu32(const mc_rtc::gui::Color & color) noexcept
                                          static_cast<float>(color.b), static_cast<float>(color.a)});
 }
 
-inline std::array<float, 4> to_rgba(const mc_rtc::gui::Color & color) noexcept
-{
-  return {static_cast<float>(color.r), static_cast<float>(color.g), static_cast<float>(color.b),
-          static_cast<float>(color.a)};
-}
-
 /** Convert a Vector3d to an homogeneous Vector4f */
 inline Eigen::Vector4f to_homo(const Eigen::Vector3d & p) noexcept
 {
@@ -71,11 +65,23 @@ void MujocoClient::draw2D(GLFWwindow * window)
   glGetFloatv(GL_PROJECTION_MATRIX, projection_.data());
   auto view = Eigen::Map<Eigen::Matrix4f>(view_.data());
   auto projection = Eigen::Map<Eigen::Matrix4f>(projection_.data());
-  mvp_ = projection * view;
+  Eigen::Matrix4f mvp = projection * view;
 
   int width;
   int height;
   glfwGetWindowSize(window, &width, &height);
+  if(mvp != mvp_ || static_cast<float>(width) != width_ || static_cast<float>(height) != height_)
+  {
+    view_version_++;
+  }
+  mvp_ = mvp;
+  for(int i = 0; i < 3; ++i)
+  {
+    frustum_[2 * i] = (mvp.row(3) + mvp.row(i)).transpose();
+    frustum_[2 * i + 1] = (mvp.row(3) - mvp.row(i)).transpose();
+  }
+  Eigen::Matrix3d R = view.topLeftCorner<3, 3>().cast<double>();
+  eye_ = -R.transpose() * view.topRightCorner<3, 1>().cast<double>();
   width_ = static_cast<float>(width);
   height_ = static_cast<float>(height);
 
@@ -97,31 +103,10 @@ void MujocoClient::draw2D(GLFWwindow * window)
 
 void MujocoClient::draw3D()
 {
-  geoms_.clear();
+  batch_.clear();
+  culled_ = 0;
   mc_rtc::imgui::Client::draw3D();
-}
-
-void MujocoClient::updateScene(mjvScene & scene)
-{
-  for(const auto & g : geoms_)
-  {
-    if(scene.ngeom < scene.maxgeom)
-    {
-      scene.geoms[scene.ngeom] = g;
-      scene.ngeom++;
-    }
-    else
-    {
-      static bool warned_once = false;
-      if(!warned_once)
-      {
-        mc_rtc::log::critical(
-            "Too many geometric objects in the scene, increase maxgeom in model, some elements will not be visible");
-        warned_once = true;
-      }
-      break;
-    }
-  }
+  batch_.draw(view_, projection_);
 }
 
 void MujocoClient::point3d(const ElementId & id,
@@ -217,71 +202,91 @@ ImVec2 MujocoClient::to_screen(const Eigen::Vector3d & point)
   return internal::to_screen(point, mvp_, width_, height_);
 }
 
+bool MujocoClient::project(const Eigen::Vector3d & point, Eigen::Vector2f & out) const noexcept
+{
+  Eigen::Vector4f p = mvp_ * internal::to_homo(point);
+  if(p.w() <= 0)
+  {
+    return false;
+  }
+  out.x() = (0.5f + 0.5f * p.x() / p.w()) * width_;
+  out.y() = (0.5f - 0.5f * p.y() / p.w()) * height_;
+  return true;
+}
+
 void MujocoClient::draw_line(const Eigen::Vector3d & from,
                              const Eigen::Vector3d & to,
-                             const mc_rtc::gui::Color & color_)
+                             const mc_rtc::gui::Color & color,
+                             double width)
 {
-  geoms_.push_back({});
-  auto & geom = geoms_.back();
-  double length = (to - from).norm();
-  double size[3] = {1.0, 1.0, length};
-  Eigen::Matrix3d orientation =
-      Eigen::Quaterniond::FromTwoVectors(to - from, Eigen::Vector3d::UnitZ()).toRotationMatrix();
-  auto color = internal::to_rgba(color_);
-  mjv_initGeom(&geom, mjGEOM_LINE, size, from.data(), orientation.data(), color.data());
+  static const double default_width = mc_rtc::gui::LineConfig{}.width;
+  batch_.line(from, to, color, static_cast<float>(width / default_width));
 }
 
 void MujocoClient::draw_box(const Eigen::Vector3d & center,
                             const Eigen::Matrix3d & orientation,
                             const Eigen::Vector3d & size,
-                            const mc_rtc::gui::Color & color_)
+                            const mc_rtc::gui::Color & color)
 {
-  geoms_.push_back({});
-  auto & geom = geoms_.back();
-  auto color = internal::to_rgba(color_);
-  mjv_initGeom(&geom, mjGEOM_BOX, size.data(), center.data(), orientation.data(), color.data());
+  batch_.box(center, orientation, size, color);
 }
 
-void MujocoClient::draw_sphere(const Eigen::Vector3d & center, double radius, const mc_rtc::gui::Color & color_)
+void MujocoClient::draw_sphere(const Eigen::Vector3d & center, double radius, const mc_rtc::gui::Color & color)
 {
-  geoms_.push_back({});
-  auto & geom = geoms_.back();
-  double size[3] = {radius, radius, radius};
-  Eigen::Matrix3d mat = Eigen::Matrix3d::Identity();
-  auto color = internal::to_rgba(color_);
-  mjv_initGeom(&geom, mjGEOM_SPHERE, size, center.data(), mat.data(), color.data());
+  batch_.sphere(center, radius, color);
 }
 
-void MujocoClient::draw_arrow(const Eigen::Vector3d & from_,
-                              const Eigen::Vector3d & to_,
-                              double shaft_diam_,
-                              double head_diam_,
-                              double head_len_,
-                              const mc_rtc::gui::Color & color_) noexcept
+void MujocoClient::draw_mesh(const std::string & path,
+                             const sva::PTransformd & pos,
+                             const Eigen::Vector3d & scale,
+                             const mc_rtc::gui::Color & color)
 {
-  geoms_.push_back({});
-  auto & geom = geoms_.back();
-  auto type = mjGEOM_ARROW;
-  if(head_diam_ == 0.0 || head_len_ == 0.0)
-  {
-    type = mjGEOM_CYLINDER;
-  }
-  if(head_diam_ == shaft_diam_)
+  batch_.mesh(path, pos, scale, color);
+}
+
+void MujocoClient::draw_arrow(const Eigen::Vector3d & from,
+                              const Eigen::Vector3d & to,
+                              double shaft_diam,
+                              double head_diam,
+                              double head_len,
+                              const mc_rtc::gui::Color & color) noexcept
+{
+  batch_.arrow(from, to, shaft_diam, head_diam, head_len, color);
+}
+
+bool MujocoClient::visible(const Eigen::Vector3d & center, const Eigen::Vector3d & half_size) noexcept
+{
+  Eigen::Vector3f c = center.cast<float>();
+  Eigen::Vector3f h = half_size.cast<float>();
+  for(const auto & plane : frustum_)
   {
-    type = mjGEOM_ARROW1;
+    // The box is outside if its corner that is the furthest along the plane normal is behind the plane
+    if(plane.head<3>().dot(c) + plane.w() + plane.head<3>().cwiseAbs().dot(h) < 0)
+    {
+      culled_++;
+      return false;
+    }
   }
-  Eigen::Vector3d dir_ = (to_ - from_);
-  // FIXME For some reason it seems size[2] is half of the arrow length?
-  double size[3] = {shaft_diam_, shaft_diam_, 2 * dir_.norm()};
-  Eigen::Matrix3d orientation = Eigen::Quaterniond::FromTwoVectors(dir_, Eigen::Vector3d::UnitZ()).toRotationMatrix();
-  auto color = internal::to_rgba(color_);
-  mjv_initGeom(&geom, type, size, from_.data(), orientation.data(), color.data());
+  return true;
+}
+
+bool MujocoClient::far(const Eigen::Vector3d & center, double radius) const noexcept
+{
+  return lod_distance > 0 && (center - eye_).norm() - radius > lod_distance;
 }
 
-void MujocoClient::draw_frame(const sva::PTransformd & pos, double size) noexcept
+void MujocoClient::draw_frame(const sva::PTransformd & pos, double size, bool simple) noexcept
 {
   auto draw_axis = [&](const Eigen::Vector3d & unit, const mc_rtc::gui::Color & color) {
-    draw_arrow(pos.translation(), (sva::PTransformd{unit} * pos).translation(), 0.015, 0.015, 0.2 * size, color);
+    const auto & end = (sva::PTransformd{unit} * pos).translation();
+    if(simple)
+    {
+      draw_line(pos.translation(), end, color);
+    }
+    else
+    {
+      draw_arrow(pos.translation(), end, 0.015, 0.015, 0.2 * size, color);
+    }
   };
   draw_axis(size * Eigen::Vector3d::UnitX(), mc_rtc::gui::Color::Red);
   draw_axis(size * Eigen::Vector3d::UnitY(), mc_rtc::gui::Color::Green);
@@ -296,14 +301,10 @@ void MujocoClient::draw_polygon(const std::vector<Eigen::Vector3d> & points,
   {
     return;
   }
-  auto lineTo = [&](const Eigen::Vector3d & p) { drawList_->PathLineTo(to_screen(p)); };
-  for(const auto & p : points)
-    for(size_t i = 0; i < points.size(); ++i)
-    {
-      const auto & p0 = points[i];
-      const auto & p1 = points[(i + 1) % points.size()];
-      draw_line(p0, p1, color_);
-    }
+  for(size_t i = 0; i < points.size(); ++i)
+  {
+    draw_line(points[i], points[(i + 1) % points.size()], color_, thickness);
+  }
 }
 
 } // namespace mc_mujoco
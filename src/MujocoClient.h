@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BatchRenderer.h"
 #include "Client.h"
 
 #include "glfw3.h"
@@ -22,9 +23,14 @@ struct MujocoClient : public mc_rtc::imgui::Client
 
   void draw2D(GLFWwindow * window);
 
+  /** Draw the 3D elements of the GUI on top of the scene, must be called after mjr_render */
   void draw3D();
 
-  void updateScene(mjvScene & scene);
+  /** Batch used to draw the 3D elements */
+  inline BatchRenderer & batch() noexcept
+  {
+    return batch_;
+  }
 
   inline const std::array<float, 16> & view() const noexcept
   {
@@ -36,11 +42,52 @@ struct MujocoClient : public mc_rtc::imgui::Client
     return projection_;
   }
 
-  void draw_line(const Eigen::Vector3d & from, const Eigen::Vector3d & to, const mc_rtc::gui::Color & color);
+  /** Incremented when the camera or the window size changes, elements drawn in screen-space depend on it */
+  inline uint64_t view_version() const noexcept
+  {
+    return view_version_;
+  }
+
+  /** True if the box centered on center with the given half size intersects the view frustum
+   *
+   * Elements outside the frustum are counted in culled()
+   */
+  bool visible(const Eigen::Vector3d & center, const Eigen::Vector3d & half_size) noexcept;
+
+  /** True if the bounding sphere of an element is further than lod_distance from the camera */
+  bool far(const Eigen::Vector3d & center, double radius) const noexcept;
 
-  inline void draw_line(const sva::PTransformd & from, const sva::PTransformd & to, const mc_rtc::gui::Color & color)
+  /** Elements further than this distance from the camera are drawn with less details, zero disables this */
+  double lod_distance = 0.0;
+
+  /** Number of elements outside of the view in the last draw3D */
+  inline size_t culled() const noexcept
   {
-    draw_line(from.translation(), to.translation(), color);
+    return culled_;
+  }
+
+  /** Project a world point to screen coordinates (in pixels), returns false if the point is behind the camera */
+  bool project(const Eigen::Vector3d & point, Eigen::Vector2f & out) const noexcept;
+
+  /** Maximum number of points kept by trajectories that are streamed point by point */
+  size_t trajectory_max_points = 10000;
+
+  /** Trajectory points closer than this distance (in pixels) to the simplified line are not drawn */
+  float trajectory_tolerance = 1.0f;
+
+  /** Draw a line, \p width is given in the unit of mc_rtc::gui::LineConfig and the default width is drawn with the
+   * batch's line width */
+  void draw_line(const Eigen::Vector3d & from,
+                 const Eigen::Vector3d & to,
+                 const mc_rtc::gui::Color & color,
+                 double width = mc_rtc::gui::LineConfig{}.width);
+
+  inline void draw_line(const sva::PTransformd & from,
+                        const sva::PTransformd & to,
+                        const mc_rtc::gui::Color & color,
+                        double width = mc_rtc::gui::LineConfig{}.width)
+  {
+    draw_line(from.translation(), to.translation(), color, width);
   }
 
   void draw_box(const Eigen::Vector3d & center,
@@ -50,6 +97,11 @@ struct MujocoClient : public mc_rtc::imgui::Client
 
   void draw_sphere(const Eigen::Vector3d & center, double radius, const mc_rtc::gui::Color & color);
 
+  void draw_mesh(const std::string & path,
+                 const sva::PTransformd & pos,
+                 const Eigen::Vector3d & scale,
+                 const mc_rtc::gui::Color & color);
+
   void draw_arrow(const Eigen::Vector3d & from,
                   const Eigen::Vector3d & to,
                   double shaft_diam,
@@ -57,7 +109,8 @@ struct MujocoClient : public mc_rtc::imgui::Client
                   double head_len,
                   const mc_rtc::gui::Color & color) noexcept;
 
-  void draw_frame(const sva::PTransformd & pos, double size = 0.1) noexcept;
+  /** Draw the axes of a frame, as lines if simple is true */
+  void draw_frame(const sva::PTransformd & pos, double size = 0.1, bool simple = false) noexcept;
 
   void draw_polygon(const std::vector<Eigen::Vector3d> & points,
                     const mc_rtc::gui::Color & color,
@@ -124,10 +177,16 @@ protected:
 private:
   std::array<float, 16> view_;
   std::array<float, 16> projection_;
-  std::vector<mjvGeom> geoms_;
-  Eigen::Matrix4f mvp_;
-  float width_;
-  float height_;
+  BatchRenderer batch_;
+  Eigen::Matrix4f mvp_ = Eigen::Matrix4f::Zero();
+  float width_ = 0.0f;
+  float height_ = 0.0f;
+  uint64_t view_version_ = 0;
+  /** Planes of the view frustum, a point p is inside if p.dot(plane.head<3>()) + plane.w() >= 0 for every plane */
+  std::array<Eigen::Vector4f, 6> frustum_;
+  /** Position of the camera in world frame */
+  Eigen::Vector3d eye_ = Eigen::Vector3d::Zero();
+  size_t culled_ = 0;
   ImDrawList * drawList_;
 
   ImVec2 to_screen(const Eigen::Vector3d & point);
@@ -46,7 +46,29 @@ int main(int argc, char * argv[])
       ("without-mc-rtc-gui", po::bool_switch(), "Disable mc_rtc GUI")
       ("with-collisions", po::bool_switch(), "Visualize collisions model")
       ("without-visuals", po::bool_switch(), "Disable visuals display")
-      ("sync", po::bool_switch(&config.sync_real_time), "Synchronize mc_mujoco simulation time with real time");
+      ("sync", po::bool_switch(&config.sync_real_time), "Synchronize mc_mujoco simulation time with real time")
+      ("max-fps", po::value<double>(&config.max_fps), "Limit the rendering rate (0: v-sync only)")
+      ("target-fps", po::value<double>(&config.target_fps), "Lower the rendering quality below this rate (0: never)")
+      ("background-fps", po::value<double>(&config.background_fps), "Rendering rate when the window is not focused")
+      ("upload-budget", po::value<double>(&config.asset_upload_budget), "Asset upload ms per frame (0: at startup)")
+      ("offscreen", po::bool_switch(&config.offscreen), "Enable offscreen rendering (MuJoCo::SaveImage)")
+      ("offscreen-width", po::value<int>(&config.offscreen_width), "Width of the offscreen images")
+      ("offscreen-height", po::value<int>(&config.offscreen_height), "Height of the offscreen images")
+      ("record", po::value<std::string>(&config.record_path), "Record to a .y4m video or a directory of PPM images")
+      ("record-fps", po::value<double>(&config.record_fps), "Recording rate in simulation time")
+      ("record-camera", po::value<std::string>(&config.record_camera), "Model camera used for the recording")
+      ("gui-rate", po::value<double>(&config.gui_update_rate), "Rate of the GUI updates (0: every frame)")
+      ("gui-lod-distance", po::value<double>(&config.gui_lod_distance), "Simplify further GUI elements (0: never)")
+      ("plot-history", po::value<double>(&config.plot_history), "Seconds of simulation kept by the live plots")
+      ("mesh-lod", po::bool_switch(&config.mesh_lod), "Draw simplified meshes when they are small on the screen")
+      ("trajectory-max-points", po::value<size_t>(&config.trajectory_max_points), "Points kept by GUI trajectories")
+      ("checkpoint-period", po::value<double>(&config.checkpoint_period), "Save a checkpoint every N simulated seconds")
+      ("checkpoint-path", po::value<std::string>(&config.checkpoint_path), "Where checkpoints are saved")
+      ("resume", po::value<std::string>(&config.resume), "Resume the simulation from a checkpoint")
+      ("settle", po::value<double>(&config.settle_time), "Settle the scene for N seconds before starting")
+      ("playback-log", po::value<std::string>(&config.playback_log), "Play back an mc_rtc log kinematically")
+      ("playback-speed", po::value<double>(&config.playback_speed), "Playback speed factor (0: as fast as possible)")
+      ("command-file", po::value<std::string>(&config.command_file), "Play joint references from a CSV or mc_rtc log");
     // clang-format on
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
@@ -0,0 +1,77 @@
+#include "mj_asset_upload.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace mc_mujoco
+{
+
+void MjAssetUpload::start(const mjModel * model, mjrContext & context, int fontscale, bool lazy)
+{
+  queue_.clear();
+  next_ = 0;
+#if mjVERSION_HEADER >= 220
+  if(lazy && (model->nmesh > 0 || model->ntex > 0))
+  {
+    // The context is sized from the model but the empty assets are uploaded instantly
+    mjModel * stub = mj_copyModel(nullptr, model);
+    for(int i = 0; i < stub->nmesh; ++i)
+    {
+      stub->mesh_vertnum[i] = 0;
+      stub->mesh_facenum[i] = 0;
+      stub->mesh_graphadr[i] = -1;
+    }
+    for(int i = 0; i < stub->ntex; ++i)
+    {
+      stub->tex_width[i] = 1;
+      stub->tex_height[i] = 1;
+    }
+    mjr_makeContext(stub, &context, fontscale);
+    mj_deleteModel(stub);
+    // Textures first as they are few and cover large areas (floor, skybox), then the smaller meshes
+    for(int i = 0; i < model->ntex; ++i)
+    {
+      queue_.push_back({mjOBJ_TEXTURE, i});
+    }
+    std::vector<int> meshes(model->nmesh);
+    for(int i = 0; i < model->nmesh; ++i)
+    {
+      meshes[i] = i;
+    }
+    std::stable_sort(meshes.begin(), meshes.end(),
+                     [&](int a, int b) { return model->mesh_facenum[a] < model->mesh_facenum[b]; });
+    for(int i : meshes)
+    {
+      queue_.push_back({mjOBJ_MESH, i});
+    }
+    return;
+  }
+#endif
+  mjr_makeContext(model, &context, fontscale);
+}
+
+bool MjAssetUpload::update(const mjModel * model, const mjrContext & context, double budget)
+{
+#if mjVERSION_HEADER >= 220
+  auto start = std::chrono::steady_clock::now();
+  while(next_ < queue_.size())
+  {
+    const auto & asset = queue_[next_++];
+    if(asset.first == mjOBJ_TEXTURE)
+    {
+      mjr_uploadTexture(model, &context, asset.second);
+    }
+    else
+    {
+      mjr_uploadMesh(model, &context, asset.second);
+    }
+    if(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budget)
+    {
+      break;
+    }
+  }
+#endif
+  return done();
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Upload the meshes and textures of a model to a rendering context over several frames
+ *
+ * mjr_makeContext uploads every asset before it returns, which delays the first frame by seconds for detailed models.
+ * start() creates the context from a copy of the model whose meshes and textures are empty, then update() uploads the
+ * actual assets one at a time within a time budget on every frame. Geoms whose mesh is not uploaded yet are not drawn.
+ *
+ * Heightfields, skins and fonts are still uploaded by start().
+ */
+struct MjAssetUpload
+{
+  /** Create the context, the OpenGL context must be current
+   *
+   * \param lazy If false, upload every asset now as mjr_makeContext does
+   */
+  void start(const mjModel * model, mjrContext & context, int fontscale, bool lazy = true);
+
+  /** Upload assets for at most budget seconds
+   *
+   * \returns True once every asset is uploaded
+   */
+  bool update(const mjModel * model, const mjrContext & context, double budget);
+
+  inline bool done() const noexcept
+  {
+    return next_ == queue_.size();
+  }
+
+  /** Number of assets already uploaded */
+  inline size_t uploaded() const noexcept
+  {
+    return next_;
+  }
+
+  /** Number of assets to upload */
+  inline size_t total() const noexcept
+  {
+    return queue_.size();
+  }
+
+private:
+  /** Assets to upload (mjOBJ_TEXTURE or mjOBJ_MESH and id) in upload order */
+  std::vector<std::pair<mjtObj, int>> queue_;
+  size_t next_ = 0;
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,343 @@
+#include "mj_checkpoint.h"
+
+#include "mj_sim_impl.h"
+
+#include <mc_rtc/logging.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <cstring>
+#include <fstream>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+constexpr char CHECKPOINT_MAGIC[8] = {'M', 'C', 'M', 'J', 'C', 'K', 'P', 'T'};
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+template<typename T>
+void copy_from(std::vector<T> & out, const T * in, int size)
+{
+  out.resize(static_cast<size_t>(size));
+  if(size)
+  {
+    std::memcpy(out.data(), in, size * sizeof(T));
+  }
+}
+
+template<typename T>
+void copy_to(const std::vector<T> & in, T * out)
+{
+  if(in.size())
+  {
+    std::memcpy(out, in.data(), in.size() * sizeof(T));
+  }
+}
+
+template<typename T>
+void write_pod(std::ostream & os, const T & value)
+{
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+void read_pod(std::istream & is, T & value)
+{
+  is.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+template<typename T>
+void write_vector(std::ostream & os, const std::vector<T> & value)
+{
+  write_pod(os, static_cast<uint64_t>(value.size()));
+  os.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(T));
+}
+
+/** Number of bytes left to read in is */
+uint64_t remaining(std::istream & is)
+{
+  auto pos = is.tellg();
+  is.seekg(0, std::ios::end);
+  auto end = is.tellg();
+  is.seekg(pos);
+  return pos >= 0 && end >= pos ? static_cast<uint64_t>(end - pos) : 0;
+}
+
+/** Read a size written before size elements of elem_size bytes, the stream fails if they cannot all be in it */
+uint64_t read_size(std::istream & is, size_t elem_size)
+{
+  uint64_t size = 0;
+  read_pod(is, size);
+  if(is && size > remaining(is) / elem_size)
+  {
+    is.setstate(std::ios::failbit);
+  }
+  return is ? size : 0;
+}
+
+template<typename T>
+void read_vector(std::istream & is, std::vector<T> & value)
+{
+  uint64_t size = read_size(is, sizeof(T));
+  if(!is)
+  {
+    return;
+  }
+  value.resize(size);
+  is.read(reinterpret_cast<char *>(value.data()), size * sizeof(T));
+}
+
+void write_string(std::ostream & os, const std::string & value)
+{
+  write_pod(os, static_cast<uint64_t>(value.size()));
+  os.write(value.data(), value.size());
+}
+
+void read_string(std::istream & is, std::string & value)
+{
+  uint64_t size = read_size(is, 1);
+  if(!is)
+  {
+    return;
+  }
+  value.resize(size);
+  is.read(&value[0], size);
+}
+
+} // namespace
+
+void MjPhysicsState::save(const mjModel & model, const mjData & data)
+{
+  time = data.time;
+  copy_from(qpos, data.qpos, model.nq);
+  copy_from(qvel, data.qvel, model.nv);
+  copy_from(act, data.act, model.na);
+  copy_from(qacc_warmstart, data.qacc_warmstart, model.nv);
+  copy_from(ctrl, data.ctrl, model.nu);
+  copy_from(qfrc_applied, data.qfrc_applied, model.nv);
+  copy_from(xfrc_applied, data.xfrc_applied, 6 * model.nbody);
+  copy_from(mocap_pos, data.mocap_pos, 3 * model.nmocap);
+  copy_from(mocap_quat, data.mocap_quat, 4 * model.nmocap);
+}
+
+void MjPhysicsState::restore(const mjModel & model, mjData & data) const
+{
+  if(!matches(model))
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot restore a state that does not match model");
+  }
+  data.time = time;
+  copy_to(qpos, data.qpos);
+  copy_to(qvel, data.qvel);
+  copy_to(act, data.act);
+  copy_to(qacc_warmstart, data.qacc_warmstart);
+  copy_to(ctrl, data.ctrl);
+  copy_to(qfrc_applied, data.qfrc_applied);
+  copy_to(xfrc_applied, data.xfrc_applied);
+  copy_to(mocap_pos, data.mocap_pos);
+  copy_to(mocap_quat, data.mocap_quat);
+}
+
+bool MjPhysicsState::matches(const mjModel & model) const noexcept
+{
+  auto size_is = [](const std::vector<mjtNum> & v, int size) { return v.size() == static_cast<size_t>(size); };
+  return size_is(qpos, model.nq) && size_is(qvel, model.nv) && size_is(act, model.na)
+         && size_is(qacc_warmstart, model.nv) && size_is(ctrl, model.nu) && size_is(qfrc_applied, model.nv)
+         && size_is(xfrc_applied, 6 * model.nbody) && size_is(mocap_pos, 3 * model.nmocap)
+         && size_is(mocap_quat, 4 * model.nmocap);
+}
+
+void MjRobotState::save(const MjRobot & robot)
+{
+  name = robot.name;
+  prev_ctrl_q = robot.mj_prev_ctrl_q;
+  prev_ctrl_alpha = robot.mj_prev_ctrl_alpha;
+  prev_ctrl_jointTorque = robot.mj_prev_ctrl_jointTorque;
+  next_ctrl_q = robot.mj_next_ctrl_q;
+  next_ctrl_alpha = robot.mj_next_ctrl_alpha;
+  next_ctrl_jointTorque = robot.mj_next_ctrl_jointTorque;
+  kp = robot.kp;
+  kd = robot.kd;
+}
+
+void MjRobotState::restore(MjRobot & robot) const
+{
+  if(next_ctrl_q.size() != robot.mj_next_ctrl_q.size() || kp.size() != robot.kp.size())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>(
+        "[mc_mujoco] Cannot restore the state of {}, the checkpoint does not match the robot", robot.name);
+  }
+  robot.mj_prev_ctrl_q = prev_ctrl_q;
+  robot.mj_prev_ctrl_alpha = prev_ctrl_alpha;
+  robot.mj_prev_ctrl_jointTorque = prev_ctrl_jointTorque;
+  robot.mj_next_ctrl_q = next_ctrl_q;
+  robot.mj_next_ctrl_alpha = next_ctrl_alpha;
+  robot.mj_next_ctrl_jointTorque = next_ctrl_jointTorque;
+  robot.kp = kp;
+  robot.kd = kd;
+}
+
+bool MjCheckpoint::write(const std::string & path) const
+{
+  auto out_path = bfs::path(path);
+  if(out_path.has_parent_path() && !bfs::exists(out_path.parent_path()))
+  {
+    boost::system::error_code ec;
+    bfs::create_directories(out_path.parent_path(), ec);
+  }
+  auto tmp_path = out_path.string() + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+    if(!ofs.is_open())
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to open {} to write a checkpoint", tmp_path);
+      return false;
+    }
+    ofs.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write_pod(ofs, CHECKPOINT_VERSION);
+    write_pod(ofs, iterCount);
+    write_pod(ofs, physics.time);
+    write_vector(ofs, physics.qpos);
+    write_vector(ofs, physics.qvel);
+    write_vector(ofs, physics.act);
+    write_vector(ofs, physics.qacc_warmstart);
+    write_vector(ofs, physics.ctrl);
+    write_vector(ofs, physics.qfrc_applied);
+    write_vector(ofs, physics.xfrc_applied);
+    write_vector(ofs, physics.mocap_pos);
+    write_vector(ofs, physics.mocap_quat);
+    write_pod(ofs, static_cast<uint64_t>(robots.size()));
+    for(const auto & r : robots)
+    {
+      write_string(ofs, r.name);
+      write_vector(ofs, r.prev_ctrl_q);
+      write_vector(ofs, r.prev_ctrl_alpha);
+      write_vector(ofs, r.prev_ctrl_jointTorque);
+      write_vector(ofs, r.next_ctrl_q);
+      write_vector(ofs, r.next_ctrl_alpha);
+      write_vector(ofs, r.next_ctrl_jointTorque);
+      write_vector(ofs, r.kp);
+      write_vector(ofs, r.kd);
+    }
+    if(!ofs)
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to write checkpoint to {}", tmp_path);
+      return false;
+    }
+  }
+  boost::system::error_code ec;
+  bfs::rename(tmp_path, out_path, ec);
+  if(ec)
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to move checkpoint to {}: {}", path, ec.message());
+    return false;
+  }
+  return true;
+}
+
+void MjCheckpoint::read(const std::string & path)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  if(!ifs.is_open())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot open checkpoint {}", path);
+  }
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  ifs.read(magic, sizeof(magic));
+  uint32_t version = 0;
+  read_pod(ifs, version);
+  if(!ifs || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != CHECKPOINT_VERSION)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] {} is not a valid checkpoint (version {})", path,
+                                                     CHECKPOINT_VERSION);
+  }
+  read_pod(ifs, iterCount);
+  read_pod(ifs, physics.time);
+  read_vector(ifs, physics.qpos);
+  read_vector(ifs, physics.qvel);
+  read_vector(ifs, physics.act);
+  read_vector(ifs, physics.qacc_warmstart);
+  read_vector(ifs, physics.ctrl);
+  read_vector(ifs, physics.qfrc_applied);
+  read_vector(ifs, physics.xfrc_applied);
+  read_vector(ifs, physics.mocap_pos);
+  read_vector(ifs, physics.mocap_quat);
+  // Each robot holds at least the sizes of its name and vectors
+  uint64_t nrobots = read_size(ifs, 9 * sizeof(uint64_t));
+  robots.resize(nrobots);
+  for(auto & r : robots)
+  {
+    read_string(ifs, r.name);
+    read_vector(ifs, r.prev_ctrl_q);
+    read_vector(ifs, r.prev_ctrl_alpha);
+    read_vector(ifs, r.prev_ctrl_jointTorque);
+    read_vector(ifs, r.next_ctrl_q);
+    read_vector(ifs, r.next_ctrl_alpha);
+    read_vector(ifs, r.next_ctrl_jointTorque);
+    read_vector(ifs, r.kp);
+    read_vector(ifs, r.kd);
+  }
+  if(!ifs)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Checkpoint {} is truncated", path);
+  }
+}
+
+MjCheckpointWriter::MjCheckpointWriter() : thread_([this]() { run(); }) {}
+
+MjCheckpointWriter::~MjCheckpointWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+MjCheckpoint * MjCheckpointWriter::acquire() noexcept
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_ ? nullptr : &checkpoint_;
+}
+
+void MjCheckpointWriter::submit(const std::string & path)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    pending_ = true;
+  }
+  cv_.notify_one();
+}
+
+void MjCheckpointWriter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true)
+  {
+    cv_.wait(lock, [this]() { return pending_ || stop_; });
+    if(pending_)
+    {
+      // The buffer is not touched by the simulation while pending_ is set
+      auto path = path_;
+      lock.unlock();
+      if(checkpoint_.write(path))
+      {
+        mc_rtc::log::info("[mc_mujoco] Checkpoint at t = {:.3f}s saved to {}", checkpoint_.physics.time, path);
+      }
+      lock.lock();
+      pending_ = false;
+    }
+    if(stop_)
+    {
+      return;
+    }
+  }
+}
+
+} // namespace mc_mujoco
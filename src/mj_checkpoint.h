@@ -0,0 +1,123 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+struct MjRobot;
+
+/** Copy of the MuJoCo state needed to resume a simulation */
+struct MjPhysicsState
+{
+  /** Simulation time */
+  double time = 0.0;
+  std::vector<mjtNum> qpos;
+  std::vector<mjtNum> qvel;
+  std::vector<mjtNum> act;
+  std::vector<mjtNum> qacc_warmstart;
+  std::vector<mjtNum> ctrl;
+  std::vector<mjtNum> qfrc_applied;
+  std::vector<mjtNum> xfrc_applied;
+  std::vector<mjtNum> mocap_pos;
+  std::vector<mjtNum> mocap_quat;
+
+  /** Copy the state from data, memory is only allocated on the first call */
+  void save(const mjModel & model, const mjData & data);
+
+  /** Restore the state into data, the state must match the model */
+  void restore(const mjModel & model, mjData & data) const;
+
+  /** True if the state dimensions match the provided model */
+  bool matches(const mjModel & model) const noexcept;
+};
+
+/** Low-level control state of an \ref MjRobot */
+struct MjRobotState
+{
+  /** Name of the robot in mc_rtc */
+  std::string name;
+  std::vector<double> prev_ctrl_q;
+  std::vector<double> prev_ctrl_alpha;
+  std::vector<double> prev_ctrl_jointTorque;
+  std::vector<double> next_ctrl_q;
+  std::vector<double> next_ctrl_alpha;
+  std::vector<double> next_ctrl_jointTorque;
+  std::vector<double> kp;
+  std::vector<double> kd;
+
+  /** Copy the interpolation and gain state of the robot */
+  void save(const MjRobot & robot);
+
+  /** Restore the interpolation and gain state into the robot */
+  void restore(MjRobot & robot) const;
+};
+
+/** Everything required to resume a simulation
+ *
+ * mc_rtc cannot serialize a controller, on resume the controller is re-initialized from the restored robots' state
+ */
+struct MjCheckpoint
+{
+  /** Number of MuJoCo iterations since the start */
+  uint64_t iterCount = 0;
+  /** MuJoCo state */
+  MjPhysicsState physics;
+  /** Robots' state */
+  std::vector<MjRobotState> robots;
+
+  /** Write the checkpoint to disk
+   *
+   * The data is first written to a temporary file which is then renamed so an interrupted write never corrupts an
+   * existing checkpoint
+   *
+   * \returns False if the file could not be written
+   */
+  bool write(const std::string & path) const;
+
+  /** Read a checkpoint from disk
+   *
+   * \throws std::runtime_error if the file cannot be read or is not a valid checkpoint
+   */
+  void read(const std::string & path);
+};
+
+/** Writes checkpoints to disk in a background thread
+ *
+ * The simulation thread only pays for a copy into the writer's buffer
+ */
+struct MjCheckpointWriter
+{
+  MjCheckpointWriter();
+
+  ~MjCheckpointWriter();
+
+  /** Returns the buffer to fill with the next checkpoint
+   *
+   * \returns nullptr if the previous checkpoint is still being written
+   */
+  MjCheckpoint * acquire() noexcept;
+
+  /** Write the buffer returned by \ref acquire to path */
+  void submit(const std::string & path);
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  MjCheckpoint checkpoint_;
+  std::string path_;
+  bool pending_ = false;
+  bool stop_ = false;
+  std::thread thread_;
+
+  void run();
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,225 @@
+#include "mj_command_playback.h"
+
+#include "mj_sim_impl.h"
+
+#include <mc_rtc/log/FlatLog.h>
+#include <mc_rtc/logging.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace mc_mujoco
+{
+
+MjCommandPlayback::MjCommandPlayback(const std::string & path,
+                                     const std::vector<MjRobot> & robots,
+                                     const std::string & main_robot)
+{
+  if(bfs::path(path).extension() == ".bin")
+  {
+    loadLog(path, robots, main_robot);
+  }
+  else
+  {
+    loadCSV(path, robots);
+  }
+  if(columns_.empty() || rows_.empty())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] No joint references found in {}", path);
+  }
+  mc_rtc::log::info("[mc_mujoco] Loaded {} control steps for {} references from {}", rows_.size(), columns_.size(),
+                    path);
+}
+
+void MjCommandPlayback::loadCSV(const std::string & path, const std::vector<MjRobot> & robots)
+{
+  std::ifstream ifs(path);
+  if(!ifs.is_open())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot open command file {}", path);
+  }
+  auto find_joint = [&](const std::string & joint, Reference reference) -> bool {
+    for(size_t i = 0; i < robots.size(); ++i)
+    {
+      const auto & r = robots[i];
+      auto it = std::find(r.mj_jnt_names.begin(), r.mj_jnt_names.end(), joint);
+      if(it == r.mj_jnt_names.end())
+      {
+        continue;
+      }
+      size_t ctrl_idx = static_cast<size_t>(std::distance(r.mj_jnt_names.begin(), it));
+      if(ctrl_idx >= r.mj_next_ctrl_q.size())
+      {
+        return false;
+      }
+      columns_.push_back({i, ctrl_idx, reference});
+      return true;
+    }
+    return false;
+  };
+  /** Index in a row for each column of the file, -1 if the column is ignored */
+  std::vector<int> file_to_row;
+  std::string line;
+  std::vector<std::string> cells;
+  size_t line_no = 0;
+  while(std::getline(ifs, line))
+  {
+    line_no++;
+    boost::algorithm::trim(line);
+    if(line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    boost::algorithm::split(cells, line, boost::algorithm::is_any_of(","));
+    if(file_to_row.empty())
+    {
+      for(auto & cell : cells)
+      {
+        boost::algorithm::trim(cell);
+        auto reference = Reference::Q;
+        auto joint = cell;
+        auto sep = cell.rfind(':');
+        if(sep != std::string::npos)
+        {
+          joint = cell.substr(0, sep);
+          auto suffix = cell.substr(sep + 1);
+          reference = suffix == "alpha" ? Reference::ALPHA : Reference::TORQUE;
+          if(suffix != "alpha" && suffix != "torque")
+          {
+            mc_rtc::log::warning("[mc_mujoco] Unknown reference type {} in {}, ignoring the column", suffix, path);
+            file_to_row.push_back(-1);
+            continue;
+          }
+        }
+        if(cell == "time" || cell == "t")
+        {
+          file_to_row.push_back(-1);
+        }
+        else if(find_joint(joint, reference))
+        {
+          file_to_row.push_back(static_cast<int>(columns_.size()) - 1);
+        }
+        else
+        {
+          mc_rtc::log::warning("[mc_mujoco] No controlled joint named {} in the simulation, ignoring the column",
+                               joint);
+          file_to_row.push_back(-1);
+        }
+      }
+      continue;
+    }
+    if(cells.size() != file_to_row.size())
+    {
+      mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Expected {} values on line {} of {} but got {}",
+                                                       file_to_row.size(), line_no, path, cells.size());
+    }
+    rows_.emplace_back(columns_.size(), 0.0);
+    auto & row = rows_.back();
+    for(size_t i = 0; i < cells.size(); ++i)
+    {
+      if(file_to_row[i] != -1)
+      {
+        boost::algorithm::trim(cells[i]);
+        size_t parsed = 0;
+        try
+        {
+          row[static_cast<size_t>(file_to_row[i])] = std::stod(cells[i], &parsed);
+        }
+        catch(const std::logic_error &)
+        {
+          parsed = 0;
+        }
+        if(parsed == 0 || parsed != cells[i].size())
+        {
+          mc_rtc::log::error_and_throw<std::runtime_error>(
+              "[mc_mujoco] Invalid value \"{}\" on line {}, column {} of {}", cells[i], line_no, i + 1, path);
+        }
+      }
+    }
+  }
+}
+
+void MjCommandPlayback::loadLog(const std::string & path,
+                                const std::vector<MjRobot> & robots,
+                                const std::string & main_robot)
+{
+  auto robot_it = std::find_if(robots.begin(), robots.end(), [&](const MjRobot & r) { return r.name == main_robot; });
+  if(robot_it == robots.end())
+  {
+    return;
+  }
+  size_t robot_idx = static_cast<size_t>(std::distance(robots.begin(), robot_it));
+  const auto & r = *robot_it;
+  mc_rtc::log::FlatLog log(path);
+  std::vector<std::vector<std::vector<double>>> entries;
+  auto load_entry = [&](const char * entry, Reference reference) {
+    if(!log.has(entry))
+    {
+      return;
+    }
+    entries.push_back(log.get<std::vector<double>>(entry, {}));
+    for(size_t i = 0; i < r.mj_next_ctrl_q.size(); ++i)
+    {
+      if(r.mj_jnt_to_rjo[i] != -1)
+      {
+        columns_.push_back({robot_idx, i, reference});
+      }
+    }
+  };
+  load_entry("qOut", Reference::Q);
+  load_entry("alphaOut", Reference::ALPHA);
+  load_entry("tauOut", Reference::TORQUE);
+  rows_.resize(entries.size() ? entries[0].size() : 0);
+  for(size_t k = 0; k < rows_.size(); ++k)
+  {
+    auto & row = rows_[k];
+    row.reserve(columns_.size());
+    for(const auto & entry : entries)
+    {
+      const auto & values = entry[k];
+      for(size_t i = 0; i < r.mj_next_ctrl_q.size(); ++i)
+      {
+        auto rjo_idx = r.mj_jnt_to_rjo[i];
+        if(rjo_idx != -1)
+        {
+          row.push_back(static_cast<size_t>(rjo_idx) < values.size() ? values[rjo_idx] : 0.0);
+        }
+      }
+    }
+  }
+}
+
+void MjCommandPlayback::apply(size_t idx, std::vector<MjRobot> & robots) const
+{
+  for(auto & r : robots)
+  {
+    r.mj_prev_ctrl_q = r.mj_next_ctrl_q;
+    r.mj_prev_ctrl_alpha = r.mj_next_ctrl_alpha;
+    r.mj_prev_ctrl_jointTorque = r.mj_next_ctrl_jointTorque;
+  }
+  const auto & row = rows_[idx];
+  for(size_t i = 0; i < columns_.size(); ++i)
+  {
+    const auto & c = columns_[i];
+    auto & r = robots[c.robot_idx];
+    switch(c.reference)
+    {
+      case Reference::Q:
+        r.mj_next_ctrl_q[c.ctrl_idx] = row[i];
+        break;
+      case Reference::ALPHA:
+        r.mj_next_ctrl_alpha[c.ctrl_idx] = row[i];
+        break;
+      case Reference::TORQUE:
+        r.mj_next_ctrl_jointTorque[c.ctrl_idx] = row[i];
+        break;
+    }
+  }
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+struct MjRobot;
+
+/** Open-loop joint references streamed into the low-level control without a controller
+ *
+ * Two sources are supported:
+ * - a CSV file with one row per control step, the header names the MuJoCo joints, a JOINT column holds the position
+ *   reference, JOINT:alpha and JOINT:torque columns hold the velocity and torque references, a time column is ignored
+ * - an mc_rtc binary log (.bin), the main robot is driven by the qOut, alphaOut and tauOut entries
+ *
+ * The references replace the controller output in the robots' next control buffers so the interpolation and PD loop
+ * of MjRobot::sendControl are used as-is
+ */
+struct MjCommandPlayback
+{
+  /** Load the references and map them to the simulated robots
+   *
+   * \throws std::runtime_error if the file cannot be loaded or does not drive any joint
+   */
+  MjCommandPlayback(const std::string & path, const std::vector<MjRobot> & robots, const std::string & main_robot);
+
+  /** Number of control steps in the file */
+  inline size_t size() const noexcept
+  {
+    return rows_.size();
+  }
+
+  /** Shift the robots' control buffers and write the idx-th references as the next target */
+  void apply(size_t idx, std::vector<MjRobot> & robots) const;
+
+private:
+  enum class Reference
+  {
+    Q,
+    ALPHA,
+    TORQUE
+  };
+  struct Column
+  {
+    /** Index of the robot in the simulation */
+    size_t robot_idx;
+    /** Index in the robot's control buffers */
+    size_t ctrl_idx;
+    /** Type of reference */
+    Reference reference;
+  };
+  /** Columns in each row */
+  std::vector<Column> columns_;
+  /** References, one row per control step */
+  std::vector<std::vector<double>> rows_;
+
+  void loadCSV(const std::string & path, const std::vector<MjRobot> & robots);
+
+  void loadLog(const std::string & path, const std::vector<MjRobot> & robots, const std::string & main_robot);
+};
+
+} // namespace mc_mujoco
@@ -19,14 +19,66 @@ struct MjConfiguration
   bool with_mc_rtc_gui = true;
   /** If true, enable mc_rtc controller inside MuJoCo simulation */
   bool with_controller = true;
+  /** Maximum rendering rate, zero only limits the rendering with v-sync */
+  double max_fps = 0.0;
+  /** The rendering quality is lowered if the rendering thread cannot hold this frame rate, zero disables this */
+  double target_fps = 30.0;
+  /** Maximum rendering rate when the window is not focused, zero disables this limit */
+  double background_fps = 10.0;
+  /** Time spent uploading the meshes and textures to the GPU on every frame after the window opens (ms), zero uploads
+   * them all before the first frame */
+  double asset_upload_budget = 5.0;
+  /** If true, create an offscreen rendering context to save images, this does not require a window */
+  bool offscreen = false;
+  /** Maximum size of the offscreen images */
+  int offscreen_width = 640;
+  int offscreen_height = 480;
+  /** If non-empty, record the simulation from the start: a .y4m video or a directory of PPM images */
+  std::string record_path = "";
+  /** Recording rate in simulation time, frames are taken every 1/record_fps simulated seconds */
+  double record_fps = 30.0;
+  /** Model camera used for the recording, if empty follows the viewer camera (or a free camera without a window) */
+  std::string record_camera = "";
   /** If true, sync simulation time and real time */
   bool sync_real_time = false;
   /** If true, start in step-by-step mode */
   bool step_by_step = false;
+  /** Scene capacity reserved for decorations (contacts, forces, perturbations...) on top of the model's geoms
+   *
+   * The scene grows automatically if this is not enough
+   */
+  int scene_geom_budget = 1000;
+  /** Maximum number of points kept by a GUI trajectory that is streamed point by point */
+  size_t trajectory_max_points = 10000;
+  /** Rate at which the GUI processes the controller's updates, zero processes them on every frame */
+  double gui_update_rate = 30.0;
+  /** GUI elements further than this distance from the camera are drawn with less details, zero disables this */
+  double gui_lod_distance = 0.0;
+  /** Duration kept by the live plots (seconds of simulation) */
+  double plot_history = 120.0;
+  /** Generate simplified levels of the visual meshes and draw them when the meshes are small on the screen */
+  bool mesh_lod = false;
   /** mc_rtc configuration file */
   std::string mc_config = "";
   /** Use torque-control rather than position control */
   bool torque_control = false;
+  /** Period (in simulation time) between automatic checkpoints, disabled if zero */
+  double checkpoint_period = 0.0;
+  /** Where checkpoints are written */
+  std::string checkpoint_path = "/tmp/mc_mujoco_checkpoint.bin";
+  /** If non-empty, resume the simulation from this checkpoint */
+  std::string resume = "";
+  /** Simulated time spent settling the scene without the controller before the simulation starts, disabled if zero
+   *
+   * The settled state is cached on disk and re-used by subsequent runs with the same scene and initial configuration
+   */
+  double settle_time = 0.0;
+  /** If non-empty, play this mc_rtc log back kinematically instead of running the controller and the dynamics */
+  std::string playback_log = "";
+  /** Playback speed relative to the log timestep, zero plays the log as fast as possible */
+  double playback_speed = 1.0;
+  /** If non-empty, stream the joint references from this file (CSV or mc_rtc log) instead of running the controller */
+  std::string command_file = "";
 };
 
 } // namespace mc_mujoco
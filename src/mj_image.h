@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Image rendered from the simulation
+ *
+ * Camera sensors are published in the controller's datastore as std::shared_ptr<const MjImage> under
+ * "MuJoCo::<robot>::<camera>", the pointer changes every time a new image is available.
+ */
+struct MjImage
+{
+  int width = 0;
+  int height = 0;
+  /** Simulation time of the rendered state */
+  double time = 0.0;
+  /** RGB pixels, rows from top to bottom */
+  std::vector<uint8_t> rgb;
+  /** Distance (m) from the camera plane for each pixel, empty unless depth was requested */
+  std::vector<float> depth;
+  /** Geom id for each pixel, -1 for the background and decorations, empty unless segmentation was requested */
+  std::vector<int> segmentation;
+
+  /** Save the color image as a binary PPM file, returns false on failure */
+  bool savePPM(const std::string & path) const;
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,127 @@
+#include "mj_log_playback.h"
+
+#include "mj_sim_impl.h"
+
+#include <mc_rtc/log/FlatLog.h>
+#include <mc_rtc/logging.h>
+
+namespace mc_mujoco
+{
+
+void MjPlaybackStats::update(const mjData & data)
+{
+  frames++;
+  contacts += static_cast<size_t>(data.ncon);
+  max_ncon = std::max(max_ncon, data.ncon);
+  if(data.ncon > 0)
+  {
+    frames_in_contact++;
+  }
+  for(int i = 0; i < data.ncon; ++i)
+  {
+    double depth = -data.contact[i].dist;
+    if(depth <= 0)
+    {
+      continue;
+    }
+    penetrations++;
+    penetration_sum += depth;
+    if(depth > max_penetration)
+    {
+      max_penetration = depth;
+      max_penetration_t = data.time;
+    }
+  }
+}
+
+MjLogPlayback::MjLogPlayback(const std::string & path,
+                             const std::vector<MjRobot> & robots,
+                             const std::string & main_robot,
+                             double dt)
+: robots_(robots), dt_(dt)
+{
+  mc_rtc::log::FlatLog log(path);
+  if(!log.has("qIn") || log.size() == 0)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] No qIn entry in {}, cannot play it back", path);
+  }
+  if(log.has("t"))
+  {
+    t_ = log.get<double>("t", 0.0);
+    if(t_.size() > 1)
+    {
+      dt_ = t_[1] - t_[0];
+    }
+  }
+  else
+  {
+    t_.resize(log.size());
+    for(size_t i = 0; i < t_.size(); ++i)
+    {
+      t_[i] = static_cast<double>(i) * dt_;
+    }
+  }
+  for(size_t i = 0; i < robots.size(); ++i)
+  {
+    const auto & r = robots[i];
+    RobotPlayback rp;
+    rp.robot_idx = i;
+    if(r.name == main_robot)
+    {
+      rp.q = log.get<std::vector<double>>("qIn", {});
+      if(log.has("ff"))
+      {
+        rp.posW = log.get<sva::PTransformd>("ff", sva::PTransformd::Identity());
+      }
+    }
+    auto posW_entry = fmt::format("mujoco_{}_posW", r.name);
+    if(log.has(posW_entry))
+    {
+      rp.posW = log.get<sva::PTransformd>(posW_entry, sva::PTransformd::Identity());
+    }
+    if(r.root_qpos_idx == -1)
+    {
+      rp.posW.clear();
+    }
+    if(rp.q.size() || rp.posW.size())
+    {
+      playback_.push_back(std::move(rp));
+    }
+  }
+  mc_rtc::log::info("[mc_mujoco] Loaded {} samples ({:.2f}s) from {}", size(), size() * dt_, path);
+}
+
+void MjLogPlayback::apply(size_t idx, const mjModel & model, mjData & data) const
+{
+  data.time = t_[idx];
+  for(const auto & rp : playback_)
+  {
+    const auto & r = robots_[rp.robot_idx];
+    if(rp.q.size())
+    {
+      const auto & q = rp.q[idx];
+      for(size_t i = 0; i < r.mj_jnt_ids.size(); ++i)
+      {
+        auto rjo_idx = r.mj_jnt_to_rjo[i];
+        if(rjo_idx == -1 || static_cast<size_t>(rjo_idx) >= q.size())
+        {
+          continue;
+        }
+        data.qpos[model.jnt_qposadr[r.mj_jnt_ids[i]]] = q[rjo_idx];
+      }
+    }
+    if(rp.posW.size())
+    {
+      const auto & pos = rp.posW[idx];
+      mjtNum * root = &data.qpos[r.root_qpos_idx];
+      Eigen::Map<Eigen::Vector3d>(root) = pos.translation();
+      Eigen::Quaterniond q = Eigen::Quaterniond(pos.rotation()).inverse();
+      root[3] = q.w();
+      root[4] = q.x();
+      root[5] = q.y();
+      root[6] = q.z();
+    }
+  }
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+struct MjRobot;
+
+/** Contact statistics gathered while playing back a log */
+struct MjPlaybackStats
+{
+  /** Number of frames played */
+  size_t frames = 0;
+  /** Number of frames with at least one contact */
+  size_t frames_in_contact = 0;
+  /** Total number of contacts over all frames */
+  size_t contacts = 0;
+  /** Maximum number of contacts in a single frame */
+  int max_ncon = 0;
+  /** Number of penetrating contacts over all frames */
+  size_t penetrations = 0;
+  /** Sum of the penetration depths, used to compute the mean depth */
+  double penetration_sum = 0.0;
+  /** Deepest penetration */
+  double max_penetration = 0.0;
+  /** Time at which the deepest penetration happened */
+  double max_penetration_t = 0.0;
+
+  /** Update the statistics from the contacts in data */
+  void update(const mjData & data);
+
+  /** Mean penetration depth of the penetrating contacts */
+  inline double mean_penetration() const noexcept
+  {
+    return penetrations ? penetration_sum / static_cast<double>(penetrations) : 0.0;
+  }
+};
+
+/** Kinematic playback of an mc_rtc log
+ *
+ * The main robot is driven by the qIn and ff entries of the log. Robots recorded by mc_mujoco also have their root
+ * driven by the mujoco_{robot}_posW entry. MuJoCo only computes the kinematics and the collisions.
+ */
+struct MjLogPlayback
+{
+  /** Load the log and map its entries to the simulated robots
+   *
+   * \param path Path to the mc_rtc binary log
+   *
+   * \param robots Robots in the simulation
+   *
+   * \param main_robot Name of the controller's main robot
+   *
+   * \param dt Timestep used if the log does not contain time information
+   *
+   * \throws std::runtime_error if the log is empty or does not contain the main robot's encoders
+   */
+  MjLogPlayback(const std::string & path,
+                const std::vector<MjRobot> & robots,
+                const std::string & main_robot,
+                double dt);
+
+  /** Number of samples in the log */
+  inline size_t size() const noexcept
+  {
+    return t_.size();
+  }
+
+  /** Log timestep */
+  inline double dt() const noexcept
+  {
+    return dt_;
+  }
+
+  /** Write the idx-th sample of the log into data's qpos and time */
+  void apply(size_t idx, const mjModel & model, mjData & data) const;
+
+private:
+  struct RobotPlayback
+  {
+    /** Index of the robot in the simulation */
+    size_t robot_idx;
+    /** Encoders in reference joint order, empty if the log has no encoders for this robot */
+    std::vector<std::vector<double>> q;
+    /** Root pose, empty if the log has no pose for this robot */
+    std::vector<sva::PTransformd> posW;
+  };
+  const std::vector<MjRobot> & robots_;
+  std::vector<RobotPlayback> playback_;
+  std::vector<double> t_;
+  double dt_;
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,345 @@
+#include "mj_mesh_lod.h"
+
+#include "MeshCache.h"
+#include "config.h"
+
+#include <mc_rtc/logging.h>
+
+#include <Eigen/Geometry>
+
+#include <fmt/format.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Meshes with fewer triangles are not simplified */
+constexpr size_t MIN_TRIANGLES = 500;
+
+/** Largest relative change of the enclosed volume accepted for a simplified mesh */
+constexpr double MAX_VOLUME_CHANGE = 0.5;
+
+/** Level of the geoms of a simplified level that is never shown */
+constexpr int HIDDEN_LEVEL = -2;
+
+/** Largest distance between the bounds of a level and the bounds of the original mesh, relative to its radius */
+constexpr double MAX_BOUNDS_ERROR = 0.2;
+
+/** FNV-1a hash of the file content */
+uint64_t file_hash(const std::string & path)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  uint64_t hash = 14695981039346656037ull;
+  std::for_each(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>(), [&](char c) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  });
+  return hash;
+}
+
+/** Merge the vertices that fall in the same cell of a grid, returns the triangles that are not degenerate */
+std::vector<Eigen::Vector3f> cluster(const std::vector<Eigen::Vector3f> & triangles,
+                                     const Eigen::Vector3f & origin,
+                                     float cell)
+{
+  std::unordered_map<uint64_t, uint32_t> cells;
+  std::vector<Eigen::Vector3f> sums;
+  std::vector<int> counts;
+  std::vector<uint32_t> ids(triangles.size());
+  for(size_t i = 0; i < triangles.size(); ++i)
+  {
+    Eigen::Array3f c = ((triangles[i] - origin) / cell).array().floor();
+    uint64_t key = static_cast<uint64_t>(c.x()) | (static_cast<uint64_t>(c.y()) << 21)
+                   | (static_cast<uint64_t>(c.z()) << 42);
+    auto it = cells.find(key);
+    if(it == cells.end())
+    {
+      it = cells.emplace(key, static_cast<uint32_t>(sums.size())).first;
+      sums.push_back(Eigen::Vector3f::Zero());
+      counts.push_back(0);
+    }
+    ids[i] = it->second;
+    sums[it->second] += triangles[i];
+    counts[it->second]++;
+  }
+  std::vector<Eigen::Vector3f> out;
+  std::set<std::array<uint32_t, 3>> seen;
+  for(size_t i = 0; i < triangles.size(); i += 3)
+  {
+    std::array<uint32_t, 3> t = {ids[i], ids[i + 1], ids[i + 2]};
+    if(t[0] == t[1] || t[1] == t[2] || t[0] == t[2])
+    {
+      continue;
+    }
+    auto key = t;
+    std::sort(key.begin(), key.end());
+    if(!seen.insert(key).second)
+    {
+      continue;
+    }
+    for(auto id : t)
+    {
+      out.push_back(sums[id] / static_cast<float>(counts[id]));
+    }
+  }
+  return out;
+}
+
+/** Signed volume enclosed by the triangles, computed around center
+ *
+ * This is positive for a closed mesh whose triangles face outward, the result of an open mesh depends on center
+ */
+double volume(const std::vector<Eigen::Vector3f> & triangles, const Eigen::Vector3f & center)
+{
+  double out = 0.0;
+  for(size_t i = 0; i < triangles.size(); i += 3)
+  {
+    Eigen::Vector3d a = (triangles[i] - center).cast<double>();
+    Eigen::Vector3d b = (triangles[i + 1] - center).cast<double>();
+    Eigen::Vector3d c = (triangles[i + 2] - center).cast<double>();
+    out += a.dot(b.cross(c));
+  }
+  return out / 6.0;
+}
+
+/** Bounds of the mesh of a geom in the frame of its body */
+Eigen::AlignedBox3d mesh_bounds(const mjModel & model, int geom)
+{
+  Eigen::AlignedBox3d out;
+  int mesh = model.geom_dataid[geom];
+  if(mesh < 0)
+  {
+    return out;
+  }
+  Eigen::Map<const Eigen::Vector3d> pos(model.geom_pos + 3 * geom);
+  const mjtNum * q = model.geom_quat + 4 * geom;
+  Eigen::Matrix3d rot = Eigen::Quaterniond(q[0], q[1], q[2], q[3]).toRotationMatrix();
+  const float * vert = model.mesh_vert + 3 * model.mesh_vertadr[mesh];
+  for(int i = 0; i < model.mesh_vertnum[mesh]; ++i)
+  {
+    out.extend(pos + rot * Eigen::Map<const Eigen::Vector3f>(vert + 3 * i).cast<double>());
+  }
+  return out;
+}
+
+bool write_stl(const bfs::path & path, const std::vector<Eigen::Vector3f> & triangles)
+{
+  std::ofstream ofs(path.string(), std::ios::binary);
+  if(!ofs.is_open())
+  {
+    return false;
+  }
+  char header[80] = "mc_mujoco mesh level of detail";
+  ofs.write(header, sizeof(header));
+  auto ntriangles = static_cast<uint32_t>(triangles.size() / 3);
+  ofs.write(reinterpret_cast<const char *>(&ntriangles), sizeof(ntriangles));
+  for(size_t i = 0; i < triangles.size(); i += 3)
+  {
+    Eigen::Vector3f n = (triangles[i + 1] - triangles[i]).cross(triangles[i + 2] - triangles[i]).normalized();
+    ofs.write(reinterpret_cast<const char *>(n.data()), 3 * sizeof(float));
+    for(size_t j = 0; j < 3; ++j)
+    {
+      ofs.write(reinterpret_cast<const char *>(triangles[i + j].data()), 3 * sizeof(float));
+    }
+    uint16_t attributes = 0;
+    ofs.write(reinterpret_cast<const char *>(&attributes), sizeof(attributes));
+  }
+  return ofs.good();
+}
+
+} // namespace
+
+std::string mesh_lod(const std::string & path, double ratio)
+{
+  auto out = bfs::path(USER_FOLDER) / "cache" / "mesh_lod"
+             / fmt::format("{:016x}_{}.stl", file_hash(path), static_cast<int>(100 * ratio));
+  if(bfs::exists(out))
+  {
+    return out.string();
+  }
+  std::vector<float> data;
+  if(!load_mesh(path, data))
+  {
+    return "";
+  }
+  std::vector<Eigen::Vector3f> triangles;
+  triangles.reserve(data.size() / 6);
+  Eigen::Vector3f min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+  Eigen::Vector3f max = -min;
+  for(size_t i = 0; i < data.size(); i += 6)
+  {
+    triangles.emplace_back(data[i], data[i + 1], data[i + 2]);
+    min = min.cwiseMin(triangles.back());
+    max = max.cwiseMax(triangles.back());
+  }
+  size_t ntriangles = triangles.size() / 3;
+  size_t target = static_cast<size_t>(ratio * static_cast<double>(ntriangles));
+  if(ntriangles < MIN_TRIANGLES || target < 4)
+  {
+    return "";
+  }
+  // MuJoCo computes the frame of a mesh from the volume it encloses, a mesh that is not closed is left as it is
+  Eigen::Vector3f center = 0.5f * (min + max);
+  double original_volume = volume(triangles, center);
+  if(original_volume <= 0)
+  {
+    return "";
+  }
+  // Find the smallest cell that gets below the target number of triangles
+  float lo = 0.0f;
+  float hi = (max - min).norm();
+  std::vector<Eigen::Vector3f> best;
+  for(int i = 0; i < 16; ++i)
+  {
+    float cell = 0.5f * (lo + hi);
+    auto simplified = cluster(triangles, min, cell);
+    if(simplified.size() / 3 <= target)
+    {
+      hi = cell;
+      best = std::move(simplified);
+    }
+    else
+    {
+      lo = cell;
+    }
+  }
+  if(best.size() / 3 < 4)
+  {
+    return "";
+  }
+  // Clustering can open holes or fold triangles, the compiler could then reject the mesh or place it elsewhere
+  double change = volume(best, center) / original_volume - 1.0;
+  if(std::abs(change) > MAX_VOLUME_CHANGE)
+  {
+    mc_rtc::log::warning("[mc_mujoco] {} cannot be simplified to {} triangles without changing its volume by {:.0f}%",
+                         path, target, 100 * change);
+    return "";
+  }
+  bfs::create_directories(out.parent_path());
+  if(!write_stl(out, best))
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to write the simplified mesh {}", out.string());
+    return "";
+  }
+  mc_rtc::log::info("[mc_mujoco] Simplified {} from {} to {} triangles", path, ntriangles, best.size() / 3);
+  return out.string();
+}
+
+void MjMeshLOD::load(const mjModel & model)
+{
+  level_.assign(model.ngeom, -1);
+  base_.assign(model.ngeom, -1);
+  levels_.assign(model.ngeom, 0);
+  empty_ = true;
+  std::string suffix = MESH_LOD_SUFFIX;
+  for(int i = 0; i < model.ngeom; ++i)
+  {
+    const char * name = mj_id2name(&model, mjOBJ_GEOM, i);
+    if(!name)
+    {
+      continue;
+    }
+    std::string n = name;
+    auto pos = n.rfind(suffix);
+    if(pos == std::string::npos || pos + suffix.size() + 1 != n.size())
+    {
+      continue;
+    }
+    int base = mj_name2id(&model, mjOBJ_GEOM, n.substr(0, pos).c_str());
+    if(base < 0)
+    {
+      continue;
+    }
+    int level = n.back() - '0';
+    level_[i] = level;
+    base_[i] = base;
+    level_[base] = 0;
+    base_[base] = base;
+    levels_[base] = std::max(levels_[base], level);
+    empty_ = false;
+  }
+  // The compiler moves every mesh to the frame of its inertia, check that the levels still cover the original mesh
+  for(int i = 0; i < model.ngeom; ++i)
+  {
+    if(level_[i] <= 0 || levels_[base_[i]] == 0)
+    {
+      continue;
+    }
+    int base = base_[i];
+    auto expected = mesh_bounds(model, base);
+    auto bounds = mesh_bounds(model, i);
+    double tolerance = MAX_BOUNDS_ERROR * model.geom_rbound[base];
+    if(!bounds.isEmpty() && (bounds.min() - expected.min()).cwiseAbs().maxCoeff() <= tolerance
+       && (bounds.max() - expected.max()).cwiseAbs().maxCoeff() <= tolerance)
+    {
+      continue;
+    }
+    mc_rtc::log::warning("[mc_mujoco] The simplified levels of {} do not match the original mesh, they are not used",
+                         mj_id2name(&model, mjOBJ_GEOM, base));
+    levels_[base] = 0;
+  }
+  for(int i = 0; i < model.ngeom; ++i)
+  {
+    if(level_[i] > 0 && levels_[base_[i]] == 0)
+    {
+      level_[i] = HIDDEN_LEVEL;
+    }
+  }
+}
+
+void MjMeshLOD::filter(const mjModel & model, mjvScene & scene, int height) const noexcept
+{
+  if(empty_)
+  {
+    return;
+  }
+  const auto & cam = scene.camera;
+  Eigen::Vector3f eye =
+      0.5f * (Eigen::Map<const Eigen::Vector3f>(cam[0].pos) + Eigen::Map<const Eigen::Vector3f>(cam[1].pos));
+  // Size in pixels of one meter seen at one meter
+  float scale = 0.5f * static_cast<float>(height) * cam[0].frustum_near / std::max(cam[0].frustum_top, 1e-6f);
+  int n = 0;
+  for(int i = 0; i < scene.ngeom; ++i)
+  {
+    auto & g = scene.geoms[i];
+    if(g.objtype == mjOBJ_GEOM && level_[g.objid] == HIDDEN_LEVEL)
+    {
+      continue;
+    }
+    if(g.objtype == mjOBJ_GEOM && level_[g.objid] >= 0)
+    {
+      int base = base_[g.objid];
+      float distance = std::max((Eigen::Map<const Eigen::Vector3f>(g.pos) - eye).norm(), 1e-6f);
+      double radius = model.geom_rbound[base] * scale / distance;
+      int level = radius >= thresholds[0] ? 0 : (radius >= thresholds[1] ? 1 : 2);
+      if(std::min(level, levels_[base]) != level_[g.objid])
+      {
+        continue;
+      }
+      // Selection and segmentation see the original geom
+      g.objid = base;
+    }
+    if(n != i)
+    {
+      scene.geoms[n] = g;
+    }
+    n++;
+  }
+  scene.ngeom = n;
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Fraction of the triangles kept by each simplified level of a mesh */
+constexpr std::array<double, 2> MESH_LOD_RATIOS = {0.25, 0.05};
+
+/** Suffix of the geoms and meshes of a simplified level, followed by the level (1 or 2) */
+constexpr const char * MESH_LOD_SUFFIX = "__lod";
+
+/** Simplify a mesh by vertex clustering and write it as a binary STL
+ *
+ * The result is cached in the user folder by the hash of the mesh content and the ratio.
+ *
+ * \param path STL or OBJ mesh
+ *
+ * \param ratio Fraction of the triangles kept
+ *
+ * \returns The path of the simplified mesh, empty if the mesh could not be loaded or is too small to be simplified
+ */
+std::string mesh_lod(const std::string & path, double ratio);
+
+/** Choose the level of detail of the visual meshes in a scene
+ *
+ * The merged model holds every level of a mesh geom as geoms that are named after the original geom with a \ref
+ * MESH_LOD_SUFFIX. Every level is added to the scene, filter() keeps the one that matches the size of the geom on the
+ * screen. Levels that do not cover the original mesh once the model is compiled are never shown.
+ */
+struct MjMeshLOD
+{
+  /** Find the levels of detail in the model */
+  void load(const mjModel & model);
+
+  inline bool empty() const noexcept
+  {
+    return empty_;
+  }
+
+  /** Remove the levels that do not match the projected size of their geom from the scene
+   *
+   * \param height Height of the viewport in pixels
+   */
+  void filter(const mjModel & model, mjvScene & scene, int height) const noexcept;
+
+  /** Radius on screen (pixels) above which level 0 and level 1 are used */
+  std::array<double, 2> thresholds = {80.0, 20.0};
+
+private:
+  bool empty_ = true;
+  /** Level of each geom, -1 if the geom has no simplified levels and -2 for levels that are never shown */
+  std::vector<int> level_;
+  /** Geom of level 0 for each geom with levels */
+  std::vector<int> base_;
+  /** Number of simplified levels of each geom of level 0 */
+  std::vector<int> levels_;
+};
+
+} // namespace mc_mujoco
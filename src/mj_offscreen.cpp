@@ -0,0 +1,540 @@
+#include "mj_offscreen.h"
+
+#ifdef MC_MUJOCO_USE_EGL
+#  include <EGL/egl.h>
+#endif
+#include "glfw3.h"
+
+#include <mc_rtc/logging.h>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#  define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+
+#ifndef GL_STREAM_READ
+#  define GL_STREAM_READ 0x88E1
+#endif
+
+#ifndef GL_READ_ONLY
+#  define GL_READ_ONLY 0x88B8
+#endif
+
+#ifndef GL_COLOR_ATTACHMENT0
+#  define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+
+#ifndef GL_READ_FRAMEBUFFER
+#  define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+
+#ifndef GL_DRAW_FRAMEBUFFER
+#  define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+
+#ifndef GLAPIENTRY
+#  define GLAPIENTRY
+#endif
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Maximum number of requests waiting to be rendered */
+constexpr size_t MAX_PENDING_REQUESTS = 16;
+
+using GenBuffersFn = void(GLAPIENTRY *)(GLsizei, GLuint *);
+using DeleteBuffersFn = void(GLAPIENTRY *)(GLsizei, const GLuint *);
+using BindBufferFn = void(GLAPIENTRY *)(GLenum, GLuint);
+using BufferDataFn = void(GLAPIENTRY *)(GLenum, ptrdiff_t, const void *, GLenum);
+using MapBufferFn = void *(GLAPIENTRY *)(GLenum, GLenum);
+using UnmapBufferFn = GLboolean(GLAPIENTRY *)(GLenum);
+using BindFramebufferFn = void(GLAPIENTRY *)(GLenum, GLuint);
+using BlitFramebufferFn =
+    void(GLAPIENTRY *)(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum);
+
+} // namespace
+
+/** OpenGL entry points used by the renderer, they are loaded from the renderer's context */
+struct MjOffscreenRenderer::GLFunctions
+{
+  GenBuffersFn genBuffers = nullptr;
+  DeleteBuffersFn deleteBuffers = nullptr;
+  BindBufferFn bindBuffer = nullptr;
+  BufferDataFn bufferData = nullptr;
+  MapBufferFn mapBuffer = nullptr;
+  UnmapBufferFn unmapBuffer = nullptr;
+  BindFramebufferFn bindFramebuffer = nullptr;
+  BlitFramebufferFn blitFramebuffer = nullptr;
+
+  template<typename LoaderT>
+  bool load(LoaderT && loader)
+  {
+    genBuffers = reinterpret_cast<GenBuffersFn>(loader("glGenBuffers"));
+    deleteBuffers = reinterpret_cast<DeleteBuffersFn>(loader("glDeleteBuffers"));
+    bindBuffer = reinterpret_cast<BindBufferFn>(loader("glBindBuffer"));
+    bufferData = reinterpret_cast<BufferDataFn>(loader("glBufferData"));
+    mapBuffer = reinterpret_cast<MapBufferFn>(loader("glMapBuffer"));
+    unmapBuffer = reinterpret_cast<UnmapBufferFn>(loader("glUnmapBuffer"));
+    bindFramebuffer = reinterpret_cast<BindFramebufferFn>(loader("glBindFramebuffer"));
+    blitFramebuffer = reinterpret_cast<BlitFramebufferFn>(loader("glBlitFramebuffer"));
+    return genBuffers && deleteBuffers && bindBuffer && bufferData && mapBuffer && unmapBuffer && bindFramebuffer
+           && blitFramebuffer;
+  }
+};
+
+namespace
+{
+
+#ifdef MC_MUJOCO_USE_EGL
+/** The default EGL display is shared by every renderer, it is terminated when the last renderer is done with it */
+std::mutex egl_display_mutex;
+size_t egl_display_users = 0;
+
+bool egl_initialize(EGLDisplay & egl_display, EGLContext & egl_context)
+{
+  {
+    std::lock_guard<std::mutex> lock(egl_display_mutex);
+    egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, nullptr, nullptr))
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to initialize the EGL display (error 0x{:x})", eglGetError());
+      egl_display = EGL_NO_DISPLAY;
+      return false;
+    }
+    egl_display_users++;
+  }
+  const EGLint attributes[] = {EGL_RED_SIZE,
+                               8,
+                               EGL_GREEN_SIZE,
+                               8,
+                               EGL_BLUE_SIZE,
+                               8,
+                               EGL_ALPHA_SIZE,
+                               8,
+                               EGL_DEPTH_SIZE,
+                               24,
+                               EGL_STENCIL_SIZE,
+                               8,
+                               EGL_COLOR_BUFFER_TYPE,
+                               EGL_RGB_BUFFER,
+                               EGL_SURFACE_TYPE,
+                               EGL_PBUFFER_BIT,
+                               EGL_RENDERABLE_TYPE,
+                               EGL_OPENGL_BIT,
+                               EGL_NONE};
+  EGLConfig config;
+  EGLint n_configs = 0;
+  if(!eglChooseConfig(egl_display, attributes, &config, 1, &n_configs) || n_configs < 1)
+  {
+    mc_rtc::log::error("[mc_mujoco] No suitable EGL configuration (error 0x{:x})", eglGetError());
+    return false;
+  }
+  if(!eglBindAPI(EGL_OPENGL_API))
+  {
+    mc_rtc::log::error("[mc_mujoco] EGL does not support desktop OpenGL (error 0x{:x})", eglGetError());
+    return false;
+  }
+  egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, nullptr);
+  if(egl_context == EGL_NO_CONTEXT)
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to create the EGL context (error 0x{:x})", eglGetError());
+    return false;
+  }
+  // MuJoCo renders to its own framebuffer so the context does not need a surface
+  if(!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context))
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to make the EGL context current (error 0x{:x})", eglGetError());
+    return false;
+  }
+  return true;
+}
+
+void egl_cleanup(EGLDisplay & egl_display, EGLContext & egl_context)
+{
+  if(egl_display == EGL_NO_DISPLAY)
+  {
+    return;
+  }
+  eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if(egl_context != EGL_NO_CONTEXT)
+  {
+    eglDestroyContext(egl_display, egl_context);
+    egl_context = EGL_NO_CONTEXT;
+  }
+  std::lock_guard<std::mutex> lock(egl_display_mutex);
+  if(--egl_display_users == 0)
+  {
+    eglTerminate(egl_display);
+  }
+  egl_display = EGL_NO_DISPLAY;
+}
+#endif
+
+} // namespace
+
+bool MjImage::savePPM(const std::string & path) const
+{
+  FILE * f = fopen(path.c_str(), "wb");
+  if(!f)
+  {
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", width, height);
+  bool ok = fwrite(rgb.data(), 1, rgb.size(), f) == rgb.size();
+  return fclose(f) == 0 && ok;
+}
+
+MjOffscreenRenderer::MjOffscreenRenderer(const mjModel * model, SceneUpdate update)
+: model_(model), update_(std::move(update)), gl_(std::make_unique<GLFunctions>())
+{
+#ifndef MC_MUJOCO_USE_EGL
+  // GLFW windows can only be created from the main thread, the context is made current in the rendering thread
+  if(!glfwInit())
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Could not initialize GLFW for offscreen rendering");
+  }
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_FALSE);
+  window_ = glfwCreateWindow(64, 64, "mc_mujoco offscreen", nullptr, nullptr);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+  if(!window_)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Could not create the offscreen rendering context");
+  }
+#endif
+  mjv_defaultScene(&scene_);
+  mjr_defaultContext(&context_);
+  thread_ = std::thread([this]() { run(); });
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return ready_ || failed_; });
+  if(failed_)
+  {
+    lock.unlock();
+    thread_.join();
+    if(window_)
+    {
+      glfwDestroyWindow(window_);
+    }
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Offscreen rendering is not available");
+  }
+}
+
+MjOffscreenRenderer::~MjOffscreenRenderer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  if(window_)
+  {
+    glfwDestroyWindow(window_);
+  }
+}
+
+bool MjOffscreenRenderer::request(const mjvCamera & camera,
+                                  int width,
+                                  int height,
+                                  Callback callback,
+                                  std::shared_ptr<const MjPhysicsState> state,
+                                  MjImageOutputs outputs)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(stop_ || requests_.size() >= MAX_PENDING_REQUESTS)
+    {
+      return false;
+    }
+    requests_.push_back({camera, width, height, std::move(callback), std::move(state), outputs});
+  }
+  cv_.notify_one();
+  return true;
+}
+
+mjvCamera MjOffscreenRenderer::freeCamera(const mjModel & model)
+{
+  mjvCamera camera;
+  mjv_defaultCamera(&camera);
+  camera.type = mjCAMERA_FREE;
+  for(int i = 0; i < 3; ++i)
+  {
+    camera.lookat[i] = model.stat.center[i];
+  }
+  camera.distance = 1.5 * model.stat.extent;
+  camera.azimuth = model.vis.global.azimuth;
+  camera.elevation = model.vis.global.elevation;
+  return camera;
+}
+
+bool MjOffscreenRenderer::initialize()
+{
+#ifdef MC_MUJOCO_USE_EGL
+  if(!egl_initialize(egl_display_, egl_context_))
+  {
+    return false;
+  }
+  auto loader = [](const char * name) { return eglGetProcAddress(name); };
+#else
+  glfwMakeContextCurrent(window_);
+  auto loader = [](const char * name) { return glfwGetProcAddress(name); };
+#endif
+  if(!gl_->load(loader))
+  {
+    mc_rtc::log::error("[mc_mujoco] The offscreen rendering context does not support pixel buffer objects");
+    return false;
+  }
+  data_ = mj_makeData(model_);
+  mjv_makeScene(model_, &scene_, model_->ngeom + 1000);
+  mjr_makeContext(model_, &context_, mjFONTSCALE_100);
+  mjr_setBuffer(mjFB_OFFSCREEN, &context_);
+  if(context_.currentBuffer != mjFB_OFFSCREEN)
+  {
+    mc_rtc::log::error("[mc_mujoco] The offscreen buffer is not supported by the rendering context");
+    return false;
+  }
+  for(auto & readback : readbacks_)
+  {
+    gl_->genBuffers(1, &readback.pbo);
+    gl_->genBuffers(1, &readback.depth_pbo);
+    gl_->genBuffers(1, &readback.segmentation_pbo);
+  }
+  return true;
+}
+
+void MjOffscreenRenderer::run()
+{
+  bool ok = initialize();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_ = ok;
+    failed_ = !ok;
+  }
+  cv_.notify_all();
+  if(!ok)
+  {
+    cleanup();
+    return;
+  }
+  while(true)
+  {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      bool in_flight =
+          std::any_of(readbacks_.begin(), readbacks_.end(), [](const Readback & r) { return r.pending; });
+      if(!in_flight)
+      {
+        cv_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+      }
+      if(stop_)
+      {
+        break;
+      }
+      if(requests_.empty())
+      {
+        // Nothing else to render, complete the readbacks in flight from the oldest one
+        lock.unlock();
+        for(size_t i = 0; i < readbacks_.size(); ++i)
+        {
+          finish(readbacks_[(next_readback_ + i) % readbacks_.size()]);
+        }
+        continue;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+    }
+    render(request);
+  }
+  cleanup();
+}
+
+void MjOffscreenRenderer::render(Request & request)
+{
+  auto & readback = readbacks_[next_readback_];
+  // The buffer still holds the oldest request, map it now: its transfer had several frames to complete
+  finish(readback);
+  mjrRect viewport = {0, 0, std::min(request.width, context_.offWidth), std::min(request.height, context_.offHeight)};
+  if(viewport.width <= 0 || viewport.height <= 0)
+  {
+    mc_rtc::log::error("[mc_mujoco] Invalid offscreen image size {}x{}", request.width, request.height);
+    return;
+  }
+  const mjData * state = nullptr;
+  if(request.state)
+  {
+    request.state->restore(*model_, *data_);
+    mj_fwdPosition(model_, data_);
+    state = data_;
+  }
+  readback.image.time = update_(scene_, request.camera, state);
+  size_t npixels = static_cast<size_t>(viewport.width) * viewport.height;
+  // Asynchronous transfer to a pixel buffer, glReadPixels returns without waiting for the GPU
+  auto read_pixels = [&](GLuint pbo, GLbitfield mask, GLenum format, GLenum type, size_t size) {
+    GLuint read = context_.offFBO;
+    if(context_.offSamples > 0)
+    {
+      gl_->bindFramebuffer(GL_READ_FRAMEBUFFER, context_.offFBO);
+      gl_->bindFramebuffer(GL_DRAW_FRAMEBUFFER, context_.offFBO_r);
+      gl_->blitFramebuffer(0, 0, viewport.width, viewport.height, 0, 0, viewport.width, viewport.height, mask,
+                         GL_NEAREST);
+      read = context_.offFBO_r;
+    }
+    gl_->bindFramebuffer(GL_READ_FRAMEBUFFER, read);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    gl_->bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    gl_->bufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    glReadPixels(0, 0, viewport.width, viewport.height, format, type, nullptr);
+    gl_->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    gl_->bindFramebuffer(GL_READ_FRAMEBUFFER, context_.offFBO);
+    gl_->bindFramebuffer(GL_DRAW_FRAMEBUFFER, context_.offFBO);
+  };
+  mjr_render(viewport, &scene_, &context_);
+  read_pixels(readback.pbo, GL_COLOR_BUFFER_BIT, GL_RGB, GL_UNSIGNED_BYTE, 3 * npixels);
+  if(request.outputs.depth)
+  {
+    read_pixels(readback.depth_pbo, GL_DEPTH_BUFFER_BIT, GL_DEPTH_COMPONENT, GL_FLOAT, sizeof(float) * npixels);
+    // Recent MuJoCo versions render with a reversed depth buffer (cleared to zero) when clip control is available,
+    // mjr_readPixels then returns one minus the stored value
+    GLfloat clear_depth = 1.0f;
+    glGetFloatv(GL_DEPTH_CLEAR_VALUE, &clear_depth);
+    readback.reversed_depth = clear_depth == 0.0f;
+  }
+  if(request.outputs.segmentation)
+  {
+#if mjVERSION_HEADER >= 230
+    // Render again with each geom drawn in a flat color that encodes its index in the scene
+    mjtByte segment = scene_.flags[mjRND_SEGMENT];
+    mjtByte idcolor = scene_.flags[mjRND_IDCOLOR];
+    scene_.flags[mjRND_SEGMENT] = 1;
+    scene_.flags[mjRND_IDCOLOR] = 1;
+    mjr_render(viewport, &scene_, &context_);
+    scene_.flags[mjRND_SEGMENT] = segment;
+    scene_.flags[mjRND_IDCOLOR] = idcolor;
+    read_pixels(readback.segmentation_pbo, GL_COLOR_BUFFER_BIT, GL_RGB, GL_UNSIGNED_BYTE, 3 * npixels);
+    readback.geom_ids.resize(scene_.ngeom);
+    for(int i = 0; i < scene_.ngeom; ++i)
+    {
+      const auto & geom = scene_.geoms[i];
+      readback.geom_ids[i] = geom.objtype == mjOBJ_GEOM ? geom.objid : -1;
+    }
+#else
+    mc_rtc::log::error("[mc_mujoco] Segmentation images require MuJoCo 2.3 or later");
+    request.outputs.segmentation = false;
+#endif
+  }
+  glFlush();
+  readback.image.width = viewport.width;
+  readback.image.height = viewport.height;
+  readback.outputs = request.outputs;
+  readback.callback = std::move(request.callback);
+  readback.pending = true;
+  next_readback_ = (next_readback_ + 1) % readbacks_.size();
+}
+
+void MjOffscreenRenderer::finish(Readback & readback)
+{
+  if(!readback.pending)
+  {
+    return;
+  }
+  readback.pending = false;
+  auto & image = readback.image;
+  size_t width = static_cast<size_t>(image.width);
+  size_t height = static_cast<size_t>(image.height);
+  // Map a pixel buffer and copy it with the rows flipped, OpenGL rows start at the bottom of the image
+  auto read = [&](GLuint pbo, size_t row, auto & out) {
+    gl_->bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    auto pixels = static_cast<const uint8_t *>(gl_->mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if(pixels)
+    {
+      out.resize(row * height);
+      auto dst = reinterpret_cast<uint8_t *>(out.data());
+      size_t row_bytes = row * sizeof(out[0]);
+      for(size_t i = 0; i < height; ++i)
+      {
+        std::memcpy(dst + i * row_bytes, pixels + (height - 1 - i) * row_bytes, row_bytes);
+      }
+      gl_->unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl_->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return pixels != nullptr;
+  };
+  bool ok = read(readback.pbo, 3 * width, image.rgb);
+  if(ok && readback.outputs.depth && (ok = read(readback.depth_pbo, width, image.depth)))
+  {
+    // Convert the depth buffer to the distance from the camera plane
+    double extent = model_->stat.extent;
+    float near = static_cast<float>(model_->vis.map.znear * extent);
+    float far = static_cast<float>(model_->vis.map.zfar * extent);
+    Eigen::Map<Eigen::ArrayXf> depth(image.depth.data(), image.depth.size());
+    if(readback.reversed_depth)
+    {
+      depth = 1.0f - depth;
+    }
+    depth = near / (1.0f - depth * (1.0f - near / far));
+  }
+  std::vector<uint8_t> ids;
+  if(ok && readback.outputs.segmentation && (ok = read(readback.segmentation_pbo, 3 * width, ids)))
+  {
+    image.segmentation.resize(width * height);
+    int ngeom = static_cast<int>(readback.geom_ids.size());
+    for(size_t i = 0; i < image.segmentation.size(); ++i)
+    {
+      // The background is black, scene geoms start at 1
+      int id = ids[3 * i] + (ids[3 * i + 1] << 8) + (ids[3 * i + 2] << 16) - 1;
+      image.segmentation[i] = id >= 0 && id < ngeom ? readback.geom_ids[id] : -1;
+    }
+  }
+  auto callback = std::move(readback.callback);
+  readback.callback = nullptr;
+  if(!ok)
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to read an offscreen image back");
+  }
+  else if(callback)
+  {
+    callback(std::move(image));
+  }
+  image = MjImage{};
+}
+
+void MjOffscreenRenderer::cleanup()
+{
+  for(auto & readback : readbacks_)
+  {
+    for(auto pbo : {&readback.pbo, &readback.depth_pbo, &readback.segmentation_pbo})
+    {
+      if(*pbo)
+      {
+        gl_->deleteBuffers(1, pbo);
+        *pbo = 0;
+      }
+    }
+  }
+  if(data_)
+  {
+    mj_deleteData(data_);
+    data_ = nullptr;
+  }
+  mjr_freeContext(&context_);
+  mjv_freeScene(&scene_);
+#ifdef MC_MUJOCO_USE_EGL
+  egl_cleanup(egl_display_, egl_context_);
+#else
+  glfwMakeContextCurrent(nullptr);
+#endif
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "mj_checkpoint.h"
+#include "mj_image.h"
+
+#include "mujoco.h"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace mc_mujoco
+{
+
+/** Buffers read back in addition to the color of an offscreen image */
+struct MjImageOutputs
+{
+  /** Metric depth, see MjImage::depth */
+  bool depth = false;
+  /** Geom ids, see MjImage::segmentation */
+  bool segmentation = false;
+};
+
+/** Renders the simulation without a window
+ *
+ * The renderer owns an OpenGL context (created with EGL when mc_mujoco is built with MC_MUJOCO_USE_EGL, otherwise
+ * from a hidden GLFW window), a scene and a MuJoCo rendering context. Requests are served by a dedicated thread that
+ * renders into MuJoCo's offscreen buffer and reads the pixels back through a ring of pixel buffers: the readback of a
+ * request overlaps the rendering of the next ones. Requesting an image never blocks.
+ */
+struct MjOffscreenRenderer
+{
+  /** Update the scene as seen from camera, returns the simulation time of the rendered state
+   *
+   * state is the renderer's copy of a state provided with the request, null if the current simulation state should be
+   * used. This is called from the renderer thread.
+   */
+  using SceneUpdate = std::function<double(mjvScene & scene, mjvCamera & camera, const mjData * state)>;
+
+  /** Receives a rendered image, called from the renderer thread */
+  using Callback = std::function<void(MjImage && image)>;
+
+  /** Create the context and start the rendering thread
+   *
+   * Must be called from the main thread, the model's offscreen buffer size (vis.global.offwidth/offheight) limits the
+   * size of the images
+   *
+   * \throws std::runtime_error if the OpenGL context cannot be created
+   */
+  MjOffscreenRenderer(const mjModel * model, SceneUpdate update);
+
+  ~MjOffscreenRenderer();
+
+  MjOffscreenRenderer(const MjOffscreenRenderer &) = delete;
+  MjOffscreenRenderer & operator=(const MjOffscreenRenderer &) = delete;
+
+  /** Queue an image request
+   *
+   * \param state If provided, render this state rather than the simulation state at the time of rendering
+   *
+   * \param outputs Additional buffers to read back
+   *
+   * \returns False if too many requests are pending, the request is dropped
+   */
+  bool request(const mjvCamera & camera,
+               int width,
+               int height,
+               Callback callback,
+               std::shared_ptr<const MjPhysicsState> state = nullptr,
+               MjImageOutputs outputs = {});
+
+  /** Default free camera looking at the whole model */
+  static mjvCamera freeCamera(const mjModel & model);
+
+private:
+  struct Request
+  {
+    mjvCamera camera;
+    int width;
+    int height;
+    Callback callback;
+    std::shared_ptr<const MjPhysicsState> state;
+    MjImageOutputs outputs;
+  };
+  /** Readback in flight in one of the pixel buffers */
+  struct Readback
+  {
+    unsigned int pbo = 0;
+    unsigned int depth_pbo = 0;
+    unsigned int segmentation_pbo = 0;
+    MjImageOutputs outputs;
+    /** Geom id of each geom in the scene when the segmentation was rendered */
+    std::vector<int> geom_ids;
+    /** True if the depth buffer was rendered with reversed depth (one at the near plane) */
+    bool reversed_depth = false;
+    MjImage image;
+    Callback callback;
+    bool pending = false;
+  };
+
+  const mjModel * model_;
+  SceneUpdate update_;
+  GLFWwindow * window_ = nullptr;
+  /** EGL display and context of the renderer when mc_mujoco is built with MC_MUJOCO_USE_EGL */
+  void * egl_display_ = nullptr;
+  void * egl_context_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> requests_;
+  bool stop_ = false;
+  /** Result of the context creation in the rendering thread */
+  bool ready_ = false;
+  bool failed_ = false;
+
+  /** Members below are only used by the rendering thread */
+  struct GLFunctions;
+  /** OpenGL entry points loaded from the renderer's context */
+  std::unique_ptr<GLFunctions> gl_;
+  mjvScene scene_;
+  mjrContext context_;
+  /** Kinematics of the states provided with the requests */
+  mjData * data_ = nullptr;
+  std::array<Readback, 3> readbacks_;
+  size_t next_readback_ = 0;
+
+  /** Rendering thread, it owns the OpenGL context */
+  std::thread thread_;
+
+  void run();
+
+  /** Create the context, returns false on failure */
+  bool initialize();
+
+  void render(Request & request);
+
+  /** Map a pending readback and hand the image to its callback */
+  void finish(Readback & readback);
+
+  void cleanup();
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,308 @@
+#include "mj_plotter.h"
+
+#include "imgui.h"
+#include "implot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mc_mujoco
+{
+
+void MjPlotter::add(const std::string & group, const std::string & name, std::function<double()> get)
+{
+  channels_.push_back(std::make_unique<Channel>());
+  auto & channel = *channels_.back();
+  channel.group = group;
+  channel.name = name;
+  channel.get = std::move(get);
+}
+
+void MjPlotter::setHistory(double period, double history)
+{
+  size_t samples = static_cast<size_t>(std::ceil(history / std::max(period, 1e-6)));
+  capacity_ = std::max<size_t>((samples + block_size - 1) / block_size, 1) * block_size;
+}
+
+void MjPlotter::capture(double t) noexcept
+{
+  for(auto & c : channels_)
+  {
+    if(!c->enabled.load(std::memory_order_acquire))
+    {
+      continue;
+    }
+    size_t head = c->head.load(std::memory_order_relaxed);
+    if(head - c->tail.load(std::memory_order_acquire) >= queue_size)
+    {
+      c->dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    (*c->queue)[head % queue_size] = {t, c->get()};
+    c->head.store(head + 1, std::memory_order_release);
+  }
+}
+
+void MjPlotter::update()
+{
+  for(auto & c : channels_)
+  {
+    if(!c->enabled.load(std::memory_order_relaxed))
+    {
+      continue;
+    }
+    size_t tail = c->tail.load(std::memory_order_relaxed);
+    size_t head = c->head.load(std::memory_order_acquire);
+    for(; tail < head; ++tail)
+    {
+      const auto & s = (*c->queue)[tail % queue_size];
+      // The simulation was reset
+      if(c->count > c->first && s.t < c->t[(c->count - 1) % c->t.size()])
+      {
+        c->clear();
+      }
+      c->push(s);
+    }
+    c->tail.store(head, std::memory_order_release);
+  }
+}
+
+void MjPlotter::Channel::clear() noexcept
+{
+  first = 0;
+  count = 0;
+}
+
+void MjPlotter::Channel::push(const Sample & s) noexcept
+{
+  size_t capacity = t.size();
+  if(count - first == capacity)
+  {
+    first++;
+  }
+  t[count % capacity] = s.t;
+  value[count % capacity] = s.value;
+  auto & block = blocks[(count / block_size) % blocks.size()];
+  auto offset = static_cast<uint8_t>(count % block_size);
+  if(offset == 0)
+  {
+    block = {s.value, s.value, 0, 0};
+  }
+  else if(s.value < block.min)
+  {
+    block.min = s.value;
+    block.min_offset = offset;
+  }
+  else if(s.value > block.max)
+  {
+    block.max = s.value;
+    block.max_offset = offset;
+  }
+  count++;
+}
+
+void MjPlotter::enable(Channel & channel)
+{
+  if(!channel.queue)
+  {
+    channel.queue = std::make_unique<std::array<Sample, queue_size>>();
+  }
+  channel.t.resize(capacity_);
+  channel.value.resize(capacity_);
+  channel.blocks.resize(capacity_ / block_size);
+  channel.clear();
+  // Samples left from a previous selection are discarded
+  channel.tail.store(channel.head.load(std::memory_order_acquire), std::memory_order_release);
+  channel.enabled.store(true, std::memory_order_release);
+}
+
+void MjPlotter::disable(Channel & channel)
+{
+  channel.enabled.store(false, std::memory_order_release);
+}
+
+void MjPlotter::decimate(const Channel & c, double tmin, double tmax, int buckets)
+{
+  xs_.clear();
+  ys_.clear();
+  size_t capacity = c.t.size();
+  auto time = [&](size_t i) { return c.t[i % capacity]; };
+  auto lower_bound = [&](double x) {
+    size_t lo = c.first;
+    size_t hi = c.count;
+    while(lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if(time(mid) < x)
+      {
+        lo = mid + 1;
+      }
+      else
+      {
+        hi = mid;
+      }
+    }
+    return lo;
+  };
+  // Keep one sample on each side so the lines reach the edges of the plot
+  size_t start = lower_bound(tmin);
+  start = start > c.first ? start - 1 : start;
+  size_t end = std::min(lower_bound(tmax) + 1, c.count);
+  if(end <= start)
+  {
+    return;
+  }
+  size_t n = end - start;
+  buckets = std::max(buckets, 1);
+  if(n <= 2 * static_cast<size_t>(buckets))
+  {
+    for(size_t i = start; i < end; ++i)
+    {
+      xs_.push_back(time(i));
+      ys_.push_back(c.value[i % capacity]);
+    }
+    return;
+  }
+  size_t width = (n + buckets - 1) / buckets;
+  for(size_t s = start; s < end; s += width)
+  {
+    size_t e = std::min(s + width, end);
+    double min = c.value[s % capacity];
+    double max = min;
+    size_t imin = s;
+    size_t imax = s;
+    for(size_t i = s + 1; i < e;)
+    {
+      // Whole blocks use their summary
+      if(i % block_size == 0 && i + block_size <= e)
+      {
+        const auto & block = c.blocks[(i / block_size) % c.blocks.size()];
+        if(block.min < min)
+        {
+          min = block.min;
+          imin = i + block.min_offset;
+        }
+        if(block.max > max)
+        {
+          max = block.max;
+          imax = i + block.max_offset;
+        }
+        i += block_size;
+        continue;
+      }
+      double v = c.value[i % capacity];
+      if(v < min)
+      {
+        min = v;
+        imin = i;
+      }
+      if(v > max)
+      {
+        max = v;
+        imax = i;
+      }
+      ++i;
+    }
+    // Keep the order of the extrema so the shape of the signal is preserved
+    size_t i0 = std::min(imin, imax);
+    size_t i1 = std::max(imin, imax);
+    xs_.push_back(time(i0));
+    ys_.push_back(c.value[i0 % capacity]);
+    if(i1 != i0)
+    {
+      xs_.push_back(time(i1));
+      ys_.push_back(c.value[i1 % capacity]);
+    }
+  }
+}
+
+void MjPlotter::draw(bool * open)
+{
+  ImGui::SetNextWindowSize(ImVec2(900, 400), ImGuiCond_FirstUseEver);
+  if(!ImGui::Begin("Plots", open))
+  {
+    ImGui::End();
+    return;
+  }
+  // Channel selection
+  ImGui::BeginChild("Channels", ImVec2(250, 0), true);
+  ImGui::InputText("Filter", filter_, sizeof(filter_));
+  for(size_t i = 0; i < channels_.size();)
+  {
+    const auto & group = channels_[i]->group;
+    size_t end = i;
+    while(end < channels_.size() && channels_[end]->group == group)
+    {
+      end++;
+    }
+    if(ImGui::TreeNode(group.c_str()))
+    {
+      for(size_t j = i; j < end; ++j)
+      {
+        auto & c = *channels_[j];
+        if(filter_[0] != 0 && c.name.find(filter_) == std::string::npos)
+        {
+          continue;
+        }
+        bool enabled = c.enabled.load(std::memory_order_relaxed);
+        ImGui::PushID(static_cast<int>(j));
+        if(ImGui::Checkbox(c.name.c_str(), &enabled))
+        {
+          enabled ? enable(c) : disable(c);
+        }
+        ImGui::PopID();
+      }
+      ImGui::TreePop();
+    }
+    i = end;
+  }
+  ImGui::EndChild();
+  ImGui::SameLine();
+
+  // Plot of the selected channels
+  ImGui::BeginGroup();
+  double tlast = 0.0;
+  size_t dropped = 0;
+  for(const auto & c : channels_)
+  {
+    if(c->enabled.load(std::memory_order_relaxed) && c->count > c->first)
+    {
+      tlast = std::max(tlast, c->t[(c->count - 1) % c->t.size()]);
+      dropped += c->dropped.load(std::memory_order_relaxed);
+    }
+  }
+  ImGui::Checkbox("Follow", &follow_);
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(200.0f);
+  ImGui::SliderFloat("Window (s)", &window_, 1.0f, 300.0f, "%.0f");
+  if(dropped > 0)
+  {
+    ImGui::SameLine();
+    ImGui::Text("%zu samples dropped", dropped);
+  }
+  if(ImPlot::BeginPlot("##Plots", ImVec2(-1, -1)))
+  {
+    ImPlot::SetupAxes("Time (s)", nullptr, 0, ImPlotAxisFlags_AutoFit);
+    if(follow_)
+    {
+      ImPlot::SetupAxisLimits(ImAxis_X1, tlast - window_, tlast, ImPlotCond_Always);
+    }
+    auto limits = ImPlot::GetPlotLimits();
+    int buckets = static_cast<int>(ImPlot::GetPlotSize().x);
+    for(const auto & c : channels_)
+    {
+      if(!c->enabled.load(std::memory_order_relaxed))
+      {
+        continue;
+      }
+      decimate(*c, limits.X.Min, limits.X.Max, buckets);
+      ImPlot::PlotLine(c->name.c_str(), xs_.data(), ys_.data(), static_cast<int>(xs_.size()));
+    }
+    ImPlot::EndPlot();
+  }
+  ImGui::EndGroup();
+  ImGui::End();
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Live plots of signals sampled from the simulation thread
+ *
+ * Channels are registered before the simulation starts. Once a channel is selected in the plot window, the simulation
+ * thread samples it after every step into a lock-free single-producer/single-consumer queue that the render thread
+ * drains into the channel's history. The plots are drawn with a min/max decimation so the cost of a frame depends on
+ * the plot width rather than the number of samples in view.
+ */
+struct MjPlotter
+{
+  /** Add a channel, get is called from the simulation thread while the channel is selected */
+  void add(const std::string & group, const std::string & name, std::function<double()> get);
+
+  /** Set the duration kept by the channels
+   *
+   * \param period Time between two samples (seconds)
+   *
+   * \param history Duration kept (seconds)
+   */
+  void setHistory(double period, double history);
+
+  /** Sample the selected channels, called from the simulation thread */
+  void capture(double t) noexcept;
+
+  /** Move the new samples to the history, called from the render thread on every frame */
+  void update();
+
+  /** Draw the plot window, open is set to false when the window is closed */
+  void draw(bool * open);
+
+  inline bool empty() const noexcept
+  {
+    return channels_.empty();
+  }
+
+private:
+  struct Sample
+  {
+    double t;
+    double value;
+  };
+
+  /** Samples in the queue between the simulation and the render thread */
+  static constexpr size_t queue_size = 4096;
+
+  /** Number of samples summarized by a min/max block */
+  static constexpr size_t block_size = 64;
+
+  struct Channel
+  {
+    std::string group;
+    std::string name;
+    std::function<double()> get;
+    /** Set by the render thread once the queue is allocated */
+    std::atomic<bool> enabled{false};
+
+    /** Queue written by the simulation thread at head and read by the render thread at tail */
+    std::unique_ptr<std::array<Sample, queue_size>> queue;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    /** Samples lost because the queue was full */
+    std::atomic<size_t> dropped{0};
+
+    /** History (render thread), the i-th sample since the last clear is stored at i % capacity and the samples in
+     * [first, count) are valid */
+    std::vector<double> t;
+    std::vector<double> value;
+    size_t first = 0;
+    size_t count = 0;
+    /** Minimum and maximum of each block of samples, the b-th block is stored at b % (capacity / block_size) */
+    struct Block
+    {
+      double min;
+      double max;
+      /** Position of the extrema in the block */
+      uint8_t min_offset;
+      uint8_t max_offset;
+    };
+    std::vector<Block> blocks;
+
+    void clear() noexcept;
+    void push(const Sample & s) noexcept;
+  };
+
+  std::vector<std::unique_ptr<Channel>> channels_;
+  /** Samples kept in each channel history, a multiple of block_size */
+  size_t capacity_ = 64 * block_size;
+
+  /** Window state */
+  char filter_[128] = {0};
+  bool follow_ = true;
+  float window_ = 10.0f;
+  /** Decimated points of the channel being drawn */
+  std::vector<double> xs_;
+  std::vector<double> ys_;
+
+  void enable(Channel & channel);
+  void disable(Channel & channel);
+
+  /** Fill xs_ and ys_ with at most 2 * buckets points covering [tmin, tmax] */
+  void decimate(const Channel & channel, double tmin, double tmax, int buckets);
+};
+
+} // namespace mc_mujoco
@@ -0,0 +1,95 @@
+#include "mj_render_profiler.h"
+
+#include "implot.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+constexpr const char * PHASE_NAMES[MjRenderProfiler::Count] = {
+    "Events", "Lock wait", "Scene update", "mjr_render", "Client update", "Client draw2D", "Client draw3D", "ImGui",
+    "Swap"};
+
+} // namespace
+
+void MjRenderProfiler::end() noexcept
+{
+  size_t idx = frames_ % history_size;
+  for(size_t i = 0; i < Count; ++i)
+  {
+    history_[i][idx] = current_[i];
+  }
+  frames_++;
+}
+
+void MjRenderProfiler::reset() noexcept
+{
+  frames_ = 0;
+}
+
+double MjRenderProfiler::average(Phase phase) const noexcept
+{
+  size_t n = std::min(frames_, history_size);
+  if(n == 0)
+  {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for(size_t i = 0; i < n; ++i)
+  {
+    sum += history_[phase][i];
+  }
+  return sum / static_cast<double>(n);
+}
+
+const char * MjRenderProfiler::name(Phase phase) noexcept
+{
+  return PHASE_NAMES[phase];
+}
+
+void MjRenderProfiler::draw()
+{
+  size_t n = std::min(frames_, history_size);
+  if(n == 0)
+  {
+    return;
+  }
+  // Oldest frame first
+  size_t first = frames_ > history_size ? frames_ % history_size : 0;
+  xs_.resize(n);
+  for(auto & s : stack_)
+  {
+    s.assign(n, 0.0);
+  }
+  std::array<double, Count> average = {};
+  for(size_t j = 0; j < n; ++j)
+  {
+    xs_[j] = static_cast<double>(j);
+    size_t idx = (first + j) % history_size;
+    for(size_t i = 0; i < Count; ++i)
+    {
+      stack_[i + 1][j] = stack_[i][j] + history_[i][idx];
+      average[i] += history_[i][idx] / n;
+    }
+  }
+  if(ImPlot::BeginPlot("Render thread (ms)", ImVec2(-1, 200)))
+  {
+    ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit);
+    ImPlot::SetupAxisLimits(ImAxis_X1, 0, static_cast<double>(history_size), ImPlotCond_Always);
+    ImPlot::SetupLegend(ImPlotLocation_NorthWest, ImPlotLegendFlags_Outside);
+    for(size_t i = 0; i < Count; ++i)
+    {
+      auto label = fmt::format("{} ({:.2f}ms)###{}", PHASE_NAMES[i], average[i], i);
+      ImPlot::PlotShaded(label.c_str(), xs_.data(), stack_[i].data(), stack_[i + 1].data(), static_cast<int>(n));
+    }
+    ImPlot::EndPlot();
+  }
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Times the phases of the render thread and keeps a rolling history of the last frames
+ *
+ * A frame is started with start(), mark(phase) accounts for the time elapsed since the previous mark and end() commits
+ * the frame to the history. Marking the same phase several times in a frame accumulates the durations.
+ */
+struct MjRenderProfiler
+{
+  enum Phase
+  {
+    /** Processing the window events */
+    Events,
+    /** Waiting for rendering_mutex_ (contention with the physics) */
+    Lock,
+    /** Updating the MuJoCo scene */
+    Scene,
+    /** mjr_render (and the upscale of the scene) */
+    Render,
+    /** MujocoClient::update */
+    ClientUpdate,
+    /** MujocoClient::draw2D */
+    Draw2D,
+    /** MujocoClient::draw3D */
+    Draw3D,
+    /** ImGui frame, panel and rendering */
+    ImGui,
+    /** glfwSwapBuffers */
+    Swap,
+    Count
+  };
+
+  /** Number of frames kept in the history */
+  static constexpr size_t history_size = 300;
+
+  inline void start() noexcept
+  {
+    current_.fill(0.0);
+    last_ = std::chrono::steady_clock::now();
+  }
+
+  inline void mark(Phase phase) noexcept
+  {
+    auto now = std::chrono::steady_clock::now();
+    current_[phase] += std::chrono::duration<double, std::milli>(now - last_).count();
+    last_ = now;
+  }
+
+  void end() noexcept;
+
+  /** Forget the frames in the history */
+  void reset() noexcept;
+
+  /** Mean duration of a phase over the frames in the history (ms) */
+  double average(Phase phase) const noexcept;
+
+  /** Name of a phase as displayed in the chart */
+  static const char * name(Phase phase) noexcept;
+
+  /** Draw the history as a stacked chart (ImPlot) */
+  void draw();
+
+private:
+  std::chrono::steady_clock::time_point last_;
+  /** Duration of each phase in the current frame (ms) */
+  std::array<double, Count> current_ = {};
+  /** Duration of each phase in the last frames (ms), the next frame is written at frames_ % history_size */
+  std::array<std::array<double, history_size>, Count> history_ = {};
+  size_t frames_ = 0;
+  /** Stacked durations used by draw, the first row is zero */
+  std::vector<double> xs_;
+  std::array<std::vector<double>, Count + 1> stack_;
+};
+
+} // namespace mc_mujoco
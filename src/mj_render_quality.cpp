@@ -0,0 +1,98 @@
+#include "mj_render_quality.h"
+
+#include <GL/glew.h>
+
+#include <mc_rtc/logging.h>
+
+#include <algorithm>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Smoothing factor of the frame time average */
+constexpr double FRAME_MS_ALPHA = 0.05;
+
+} // namespace
+
+bool MjQualityGovernor::update(double dt, double target_fps)
+{
+  frame_ms = frame_ms == 0.0 ? dt : (1 - FRAME_MS_ALPHA) * frame_ms + FRAME_MS_ALPHA * dt;
+  if(target_fps <= 0)
+  {
+    bool changed = level != 0;
+    level = 0;
+    return changed;
+  }
+  auto now = std::chrono::steady_clock::now();
+  double budget = 1000.0 / target_fps;
+  double since_change = std::chrono::duration<double>(now - last_change_).count();
+  // Degrade quickly but only improve if there is a comfortable margin for a while to avoid oscillating
+  int new_level = level;
+  if(frame_ms > 1.1 * budget && since_change > 1.0)
+  {
+    new_level = std::min(level + 1, max_level);
+  }
+  else if(frame_ms < 0.5 * budget && since_change > 5.0)
+  {
+    new_level = std::max(level - 1, 0);
+  }
+  if(new_level == level)
+  {
+    return false;
+  }
+  level = new_level;
+  last_change_ = now;
+  mc_rtc::log::info("[mc_mujoco] Rendering quality: {} (frame time {:.1f}ms, target {:.1f}ms)", description(),
+                    frame_ms, budget);
+  return true;
+}
+
+double MjQualityGovernor::scale() const noexcept
+{
+  if(level == 0 || !scaling)
+  {
+    return 1.0;
+  }
+  return level == 1 ? 0.75 : 0.5;
+}
+
+const char * MjQualityGovernor::description() const noexcept
+{
+  static constexpr const char * descriptions[max_level + 1] = {
+      "full", "75% resolution", "50% resolution", "no shadows", "no reflections", "no skybox", "thin lines"};
+  return descriptions[level];
+}
+
+bool mujoco_upscale_offscreen(const mjrContext & context, const mjrRect & src, const mjrRect & dst)
+{
+  auto blit = [&](GLuint from, GLuint to, const mjrRect & s, const mjrRect & d, GLbitfield mask, GLenum filter) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, from);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, to);
+    glBlitFramebuffer(s.left, s.bottom, s.left + s.width, s.bottom + s.height, d.left, d.bottom, d.left + d.width,
+                      d.bottom + d.height, mask, filter);
+  };
+  GLuint read = context.offFBO;
+  if(context.offSamples > 0)
+  {
+    // Multisampled buffers cannot be scaled, resolve first
+    blit(context.offFBO, context.offFBO_r, src, src, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    read = context.offFBO_r;
+  }
+  blit(read, 0, src, dst, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  // The depth blit fails with GL_INVALID_OPERATION if the depth formats of the offscreen buffer and the window differ
+  while(glGetError() != GL_NO_ERROR) {}
+  blit(read, 0, src, dst, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  bool ok = glGetError() == GL_NO_ERROR;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  if(!ok)
+  {
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+  return ok;
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <chrono>
+
+namespace mc_mujoco
+{
+
+/** Lowers the rendering quality step by step to hold a target frame rate
+ *
+ * Levels, from the best to the cheapest:
+ * 0. full quality
+ * 1. render at 75% of the window resolution
+ * 2. render at 50% of the window resolution
+ * 3. no shadows
+ * 4. no reflections
+ * 5. no skybox
+ * 6. thin GUI lines
+ */
+struct MjQualityGovernor
+{
+  static constexpr int max_level = 6;
+
+  /** Current level */
+  int level = 0;
+
+  /** False if the scene cannot be upscaled to the window, levels 1 and 2 then keep the full resolution */
+  bool scaling = true;
+
+  /** Moving average of the frame time (ms) */
+  double frame_ms = 0.0;
+
+  /** Account for the cost of the last frame and change the level if needed
+   *
+   * \param dt Time spent by the render thread on the last frame (ms)
+   *
+   * \param target_fps Frame rate to hold, zero disables the governor and restores the full quality
+   *
+   * \returns True if the level changed
+   */
+  bool update(double dt, double target_fps);
+
+  /** Resolution scale of the 3D scene */
+  double scale() const noexcept;
+
+  inline bool shadows() const noexcept
+  {
+    return level < 3;
+  }
+
+  inline bool reflections() const noexcept
+  {
+    return level < 4;
+  }
+
+  inline bool skybox() const noexcept
+  {
+    return level < 5;
+  }
+
+  inline bool thin_lines() const noexcept
+  {
+    return level >= 6;
+  }
+
+  /** Description of the current level */
+  const char * description() const noexcept;
+
+private:
+  std::chrono::steady_clock::time_point last_change_ = std::chrono::steady_clock::now();
+};
+
+/** Upscale the scene rendered in the offscreen buffer to the window
+ *
+ * The offscreen buffer is resolved first if it is multisampled, the color is interpolated linearly and the depth is
+ * copied so that later draws are still occluded by the scene. The window framebuffer is bound on return.
+ *
+ * \returns False if the depth could not be copied, the depth of the window is cleared instead
+ */
+bool mujoco_upscale_offscreen(const mjrContext & context, const mjrRect & src, const mjrRect & dst);
+
+} // namespace mc_mujoco
@@ -1,8 +1,13 @@
 #include "mj_sim_impl.h"
 #include "mj_utils.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
 #include <type_traits>
 
 #include "MujocoClient.h"
@@ -125,6 +130,7 @@ MjSimImpl::MjSimImpl(const MjConfiguration & config)
   std::map<std::string, std::string> mcObjects;
   /** Map between name and pdgains file path of objects specified in mc-rtc config **/
   std::map<std::string, std::string> pdGainsFiles;
+  std::map<std::string, mc_rtc::Configuration> cameraConfigs;
 
   // load all robots named in mujoco config
   auto mc_mujoco_cfg_path = fmt::format("{}/mc_mujoco.yaml", USER_FOLDER);
@@ -184,6 +190,10 @@ MjSimImpl::MjSimImpl(const MjConfiguration & config)
       std::string xmlFile = static_cast<std::string>(robot_cfg("xmlModelPath"));
       mcObjects[r.name()] = xmlFile;
       pdGainsFiles[r.name()] = robot_cfg("pdGainsPath", std::string(""));
+      if(robot_cfg.has("cameras"))
+      {
+        cameraConfigs[r.name()] = robot_cfg("cameras");
+      }
       if(!bfs::exists(xmlFile))
       {
         mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] XML model cannot be found at {} for {}", xmlFile,
@@ -224,16 +234,275 @@ MjSimImpl::MjSimImpl(const MjConfiguration & config)
     if(config.with_mc_rtc_gui)
     {
       client = std::make_unique<MujocoClient>();
+      client->trajectory_max_points = config.trajectory_max_points;
+      client->lod_distance = config.gui_lod_distance;
     }
   }
+  // Images rendered offscreen use the options given at startup, the window's options are changed by the user
+  mjv_defaultOption(&offscreen_options_);
+  offscreen_options_.geomgroup[0] = config.visualize_collisions.value_or(false);
+  offscreen_options_.geomgroup[1] = config.visualize_visual.value_or(true);
+  mjv_defaultPerturb(&offscreen_pert_);
+  if(config.offscreen)
+  {
+    createOffscreenRenderer();
+  }
+  loadCameraSensors(cameraConfigs);
+  loadPlotChannels();
+  mesh_lod_.load(*model);
+  if(config.record_path.size())
+  {
+    startRecording(config.record_path);
+  }
   mc_rtc::log::info("[mc_mujoco] Initialized successful.");
 }
 
 void MjSimImpl::cleanup()
 {
+  offscreen_.reset();
+  camera_renderer_.reset();
+  recorder_.reset();
+  if(env_data_)
+  {
+    mj_deleteData(env_data_);
+    env_data_ = nullptr;
+  }
   mujoco_cleanup(this);
 }
 
+std::unique_ptr<MjOffscreenRenderer> MjSimImpl::makeOffscreenRenderer(int width, int height)
+{
+  auto & global = model->vis.global;
+  global.offwidth = std::max(global.offwidth, width);
+  global.offheight = std::max(global.offheight, height);
+  auto update = [this](mjvScene & scene, mjvCamera & camera, const mjData * state) {
+    if(state)
+    {
+      mjv_updateScene(model, const_cast<mjData *>(state), &offscreen_options_, &offscreen_pert_, &camera, mjCAT_ALL,
+                      &scene);
+      mesh_lod_.filter(*model, scene, model->vis.global.offheight);
+      return state->time;
+    }
+    std::lock_guard<std::mutex> lock(rendering_mutex_);
+    mjv_updateScene(model, data, &offscreen_options_, &offscreen_pert_, &camera, mjCAT_ALL, &scene);
+    mesh_lod_.filter(*model, scene, model->vis.global.offheight);
+    return data->time;
+  };
+  return std::make_unique<MjOffscreenRenderer>(model, update);
+}
+
+void MjSimImpl::createOffscreenRenderer()
+{
+  auto offscreen = makeOffscreenRenderer(config.offscreen_width, config.offscreen_height);
+  std::lock_guard<std::mutex> lock(rendering_mutex_);
+  offscreen_ = std::move(offscreen);
+  mc_rtc::log::info("[mc_mujoco] Offscreen rendering enabled ({}x{})", config.offscreen_width,
+                    config.offscreen_height);
+}
+
+void MjSimImpl::loadCameraSensors(const std::map<std::string, mc_rtc::Configuration> & configs)
+{
+  int width = 0;
+  int height = 0;
+  for(const auto & [robot_name, cameras] : configs)
+  {
+    auto robot = std::find_if(robots.begin(), robots.end(), [&](const MjRobot & r) { return r.name == robot_name; });
+    if(robot == robots.end())
+    {
+      continue;
+    }
+    for(size_t i = 0; i < cameras.size(); ++i)
+    {
+      auto c = cameras[i];
+      auto camera = std::make_unique<MjCameraSensor>();
+      camera->robot = robot_name;
+      camera->name = static_cast<std::string>(c("name"));
+      camera->camera_id = mj_name2id(model, mjOBJ_CAMERA, robot->prefixed(camera->name).c_str());
+      if(camera->camera_id < 0)
+      {
+        mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] No camera named {} in the MuJoCo model of {}",
+                                                         robot->prefixed(camera->name), robot_name);
+      }
+      camera->width = c("width", camera->width);
+      camera->height = c("height", camera->height);
+      camera->rate = c("rate", camera->rate);
+      camera->outputs.depth = c("depth", false);
+      camera->outputs.segmentation = c("segmentation", false);
+      if(camera->rate <= 0)
+      {
+        mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Invalid rate for the {} camera of {}",
+                                                         camera->name, robot_name);
+      }
+      width = std::max(width, camera->width);
+      height = std::max(height, camera->height);
+      mc_rtc::log::info("[mc_mujoco] Camera sensor {} ({}x{} at {}Hz) published as {}", camera->name, camera->width,
+                        camera->height, camera->rate, camera->datastore_key());
+      cameras_.push_back(std::move(camera));
+    }
+  }
+  if(cameras_.size())
+  {
+    // The cameras have their own renderer so that they are not delayed by the recording or the saved images
+    camera_renderer_ = makeOffscreenRenderer(width, height);
+  }
+}
+
+void MjSimImpl::loadPlotChannels()
+{
+  plotter_.setHistory(model->opt.timestep, config.plot_history);
+  auto name = [this](mjtObj type, int id) {
+    const char * n = mj_id2name(model, type, id);
+    return n ? std::string(n) : fmt::format("{}", id);
+  };
+  for(int i = 0; i < model->njnt; ++i)
+  {
+    if(model->jnt_type[i] != mjJNT_HINGE && model->jnt_type[i] != mjJNT_SLIDE)
+    {
+      continue;
+    }
+    int qpos = model->jnt_qposadr[i];
+    int dof = model->jnt_dofadr[i];
+    plotter_.add("Joints", fmt::format("{} q", name(mjOBJ_JOINT, i)), [this, qpos]() { return data->qpos[qpos]; });
+    plotter_.add("Joints", fmt::format("{} alpha", name(mjOBJ_JOINT, i)), [this, dof]() { return data->qvel[dof]; });
+  }
+  for(int i = 0; i < model->nu; ++i)
+  {
+    plotter_.add("Actuators", fmt::format("{} force", name(mjOBJ_ACTUATOR, i)),
+                 [this, i]() { return data->actuator_force[i]; });
+  }
+  for(int i = 0; i < model->nsensor; ++i)
+  {
+    int adr = model->sensor_adr[i];
+    int dim = model->sensor_dim[i];
+    for(int k = 0; k < dim; ++k)
+    {
+      auto label = dim == 1 ? name(mjOBJ_SENSOR, i) : fmt::format("{}[{}]", name(mjOBJ_SENSOR, i), k);
+      plotter_.add("Sensors", label, [this, adr, k]() { return data->sensordata[adr + k]; });
+    }
+  }
+  plotter_.add("Contacts", "Number of contacts", [this]() { return static_cast<double>(data->ncon); });
+  for(int b = 1; b < model->nbody; ++b)
+  {
+    // Sum of the normal forces of the contacts involving the body
+    plotter_.add("Contacts", fmt::format("{} normal force", name(mjOBJ_BODY, b)), [this, b]() {
+      double f = 0.0;
+      for(int i = 0; i < data->ncon; ++i)
+      {
+        const auto & c = data->contact[i];
+        if(model->geom_bodyid[c.geom1] == b || model->geom_bodyid[c.geom2] == b)
+        {
+          mjtNum force[6];
+          mj_contactForce(model, data, i, force);
+          f += force[0];
+        }
+      }
+      return f;
+    });
+  }
+  plotter_.add("Timing", "Physics step (ms)", [this]() { return log_data.step_dt; });
+  plotter_.add("Timing", "Sensors update (ms)", [this]() { return log_data.sensors_dt; });
+  plotter_.add("Timing", "Control step (ms)", [this]() { return log_data.control_dt; });
+}
+
+void MjSimImpl::requestCameraImages()
+{
+  // The state is copied once for all the cameras that are due on this step
+  std::shared_ptr<MjPhysicsState> state;
+  for(auto & camera : cameras_)
+  {
+    if(data->time < camera->next_t)
+    {
+      continue;
+    }
+    while(camera->next_t <= data->time)
+    {
+      camera->next_t += 1.0 / camera->rate;
+    }
+    if(!state)
+    {
+      state = std::make_shared<MjPhysicsState>();
+      state->save(*model, *data);
+    }
+    mjvCamera cam;
+    mjv_defaultCamera(&cam);
+    cam.type = mjCAMERA_FIXED;
+    cam.fixedcamid = camera->camera_id;
+    auto * sensor = camera.get();
+    camera_renderer_->request(
+        cam, camera->width, camera->height,
+        [sensor](MjImage && image) {
+          auto latest = std::make_shared<const MjImage>(std::move(image));
+          std::lock_guard<std::mutex> lock(sensor->mutex);
+          sensor->latest = std::move(latest);
+        },
+        state, camera->outputs);
+  }
+}
+
+void MjSimImpl::publishCameraImages()
+{
+  if(!controller)
+  {
+    return;
+  }
+  auto & datastore = controller->controller().datastore();
+  for(auto & camera : cameras_)
+  {
+    std::shared_ptr<const MjImage> image;
+    {
+      std::lock_guard<std::mutex> lock(camera->mutex);
+      image = std::move(camera->latest);
+    }
+    if(!image)
+    {
+      continue;
+    }
+    // Only the pointer is copied, the controller can keep the image for as long as it needs it
+    auto key = camera->datastore_key();
+    if(datastore.has(key))
+    {
+      datastore.assign(key, image);
+    }
+    else
+    {
+      datastore.make<std::shared_ptr<const MjImage>>(key, image);
+    }
+  }
+}
+
+bool MjSimImpl::saveImage(const std::string & path, const std::string & camera)
+{
+  std::lock_guard<std::mutex> lock(rendering_mutex_);
+  if(!offscreen_)
+  {
+    mc_rtc::log::error("[mc_mujoco] Cannot save {}, offscreen rendering is disabled", path);
+    return false;
+  }
+  mjvCamera cam = MjOffscreenRenderer::freeCamera(*model);
+  if(camera.size())
+  {
+    int id = mj_name2id(model, mjOBJ_CAMERA, camera.c_str());
+    if(id < 0)
+    {
+      mc_rtc::log::error("[mc_mujoco] Cannot save {}, no camera named {} in the model", path, camera);
+      return false;
+    }
+    cam.type = mjCAMERA_FIXED;
+    cam.fixedcamid = id;
+  }
+  bool queued = offscreen_->request(cam, config.offscreen_width, config.offscreen_height, [path](MjImage && image) {
+    if(!image.savePPM(path))
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to write {}", path);
+    }
+  });
+  if(!queued)
+  {
+    mc_rtc::log::warning("[mc_mujoco] Too many pending images, {} is not saved", path);
+  }
+  return queued;
+}
+
 void MjRobot::initialize(mjModel * model, const mc_rbdyn::Robot & robot)
 {
   mj_jnt_ids.resize(0);
@@ -521,14 +790,102 @@ void MjSimImpl::makeDatastoreCalls()
           return true;
         });
   }
+
+  // make_call for saving a checkpoint on the next step
+  controller->controller().datastore().make_call("MuJoCo::Checkpoint", [this]() { checkpoint_requested_ = true; });
+
+  // make_call for rendering the simulation to an image file, requires offscreen rendering
+  controller->controller().datastore().make_call(
+      "MuJoCo::SaveImage",
+      [this](const std::string & path, const std::string & camera) { return saveImage(path, camera); });
+
+  // make_call to display states of parallel environments next to the simulation
+  controller->controller().datastore().make_call(
+      "MuJoCo::ShowEnvironments", [this](const std::vector<std::vector<double>> & qpos, double spacing) {
+        return showEnvironments(qpos, spacing);
+      });
+}
+
+void MjSimImpl::addLogEntries()
+{
+  auto & logger = controller->controller().logger();
+  logger.removeLogEntries(this);
+  logger.addLogEntry("mujoco_timing_step", this, [this]() { return log_data.step_dt; });
+  logger.addLogEntry("mujoco_timing_sensors", this, [this]() { return log_data.sensors_dt; });
+  logger.addLogEntry("mujoco_timing_control", this, [this]() { return log_data.control_dt; });
+  logger.addLogEntry("mujoco_ncon", this, [this]() { return log_data.ncon; });
+  logger.addLogEntry("mujoco_solver_iter", this, [this]() { return log_data.solver_iter; });
+  logger.addLogEntry("mujoco_perturbation_body", this, [this]() { return log_data.perturbation_body; });
+  logger.addLogEntry("mujoco_perturbation", this, [this]() -> const sva::ForceVecd & { return log_data.perturbation; });
+  for(const auto & r : robots)
+  {
+    logger.addLogEntry(fmt::format("mujoco_{}_posW", r.name), this,
+                       [&r]() -> const sva::PTransformd & { return r.root_posW_gt; });
+  }
+}
+
+void MjSimImpl::captureLogData()
+{
+  log_data.ncon = data->ncon;
+#if mjVERSION_HEADER >= 300
+  log_data.solver_iter = data->solver_niter[0];
+#else
+  log_data.solver_iter = data->solver_iter;
+#endif
+  auto pert_body = pert.select;
+  if(pert.active && pert_body > 0)
+  {
+    const mjtNum * xfrc = &data->xfrc_applied[6 * pert_body];
+    log_data.perturbation_body = pert_body;
+    log_data.perturbation = sva::ForceVecd(Eigen::Vector3d(xfrc[3], xfrc[4], xfrc[5]),
+                                           Eigen::Vector3d(xfrc[0], xfrc[1], xfrc[2]));
+  }
+  else
+  {
+    log_data.perturbation_body = -1;
+    log_data.perturbation = sva::ForceVecd::Zero();
+  }
+  for(auto & r : robots)
+  {
+    if(r.root_body_id == -1)
+    {
+      continue;
+    }
+    const mjtNum * xquat = &data->xquat[4 * r.root_body_id];
+    r.root_posW_gt.translation() = Eigen::Map<const Eigen::Vector3d>(&data->xpos[3 * r.root_body_id]);
+    r.root_posW_gt.rotation() = Eigen::Quaterniond(xquat[0], xquat[1], xquat[2], xquat[3]).inverse().toRotationMatrix();
+  }
 }
 
 void MjSimImpl::startSimulation()
 {
   setSimulationInitialState();
+  if(config.settle_time > 0)
+  {
+    settleSimulation();
+  }
+  next_checkpoint_t_ = config.checkpoint_period;
+  if(config.playback_log.size())
+  {
+    log_playback_ = std::make_unique<MjLogPlayback>(config.playback_log, robots, controller->robot().name(),
+                                                    controller->timestep());
+    controller.reset();
+    return;
+  }
+  if(config.command_file.size())
+  {
+    // The references are given at the controller rate
+    frameskip_ = std::round(controller->timestep() / model->opt.timestep);
+    command_playback_ = std::make_unique<MjCommandPlayback>(config.command_file, robots, controller->robot().name());
+    config.with_controller = false;
+  }
   if(!config.with_controller)
   {
     controller.reset();
+    if(config.resume.size())
+    {
+      loadCheckpoint(config.resume);
+    }
     return;
   }
 
@@ -551,6 +908,11 @@ void MjSimImpl::startSimulation()
   }
   controller->init(init_qs_, init_pos_);
   controller->running = true;
+  addLogEntries();
+  if(config.resume.size())
+  {
+    loadCheckpoint(config.resume);
+  }
 }
 
 void MjRobot::updateSensors(mc_control::MCGlobalController * gc, mjModel * model, mjData * data)
@@ -639,6 +1001,7 @@ void MjSimImpl::updateData()
   {
     r.updateSensors(controller.get(), model, data);
   }
+  publishCameraImages();
 }
 
 void MjRobot::updateControl(const mc_rbdyn::Robot & robot)
@@ -725,6 +1088,15 @@ bool MjSimImpl::controlStep()
       r.updateControl(controller->robots().robot(r.name));
     }
   }
+  else if(command_playback_ && interp_idx == 0)
+  {
+    // Hold the last references once the whole file has been played
+    command_playback_->apply(std::min(command_idx_, command_playback_->size() - 1), robots);
+    if(++command_idx_ == command_playback_->size())
+    {
+      mc_rtc::log::info("[mc_mujoco] All commands from {} have been played", config.command_file);
+    }
+  }
   // On each control iter
   for(auto & r : robots)
   {
@@ -744,12 +1116,84 @@ void MjSimImpl::simStep()
   // take one step in simulation
   // model.opt.timestep will be used here
   mj_step(model, data);
+  state_version_++;
+  recordFrame();
+  requestCameraImages();
+}
+
+void MjSimImpl::recordFrame()
+{
+  if(!recorder_ || data->time < next_record_t_)
+  {
+    return;
+  }
+  // Frames are taken at fixed simulation times so that the video does not depend on the real-time factor
+  double period = 1.0 / config.record_fps;
+  while(next_record_t_ <= data->time)
+  {
+    next_record_t_ += period;
+  }
+  // Only the state is copied here, the renderer computes the kinematics and renders in its own thread
+  auto state = std::make_shared<MjPhysicsState>();
+  state->save(*model, *data);
+  auto recorder = recorder_;
+  auto push = [recorder](MjImage && image) { recorder->push(std::move(image)); };
+  if(!offscreen_->request(record_camera_, config.offscreen_width, config.offscreen_height, push, std::move(state)))
+  {
+    recorder->drop();
+  }
+}
+
+void MjSimImpl::startRecording(const std::string & path)
+{
+  if(!offscreen_)
+  {
+    createOffscreenRenderer();
+  }
+  mjvCamera camera = MjOffscreenRenderer::freeCamera(*model);
+  if(config.record_camera.size())
+  {
+    int id = mj_name2id(model, mjOBJ_CAMERA, config.record_camera.c_str());
+    if(id < 0)
+    {
+      mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot record from {}, no such camera in the model",
+                                                       config.record_camera);
+    }
+    camera.type = mjCAMERA_FIXED;
+    camera.fixedcamid = id;
+  }
+  else if(window)
+  {
+    camera = this->camera;
+  }
+  auto recorder = std::make_shared<MjVideoWriter>(path, config.record_fps);
+  std::lock_guard<std::mutex> lock(rendering_mutex_);
+  record_camera_ = camera;
+  next_record_t_ = data->time;
+  recorder_ = recorder;
+  mc_rtc::log::info("[mc_mujoco] Recording to {} at {} frames per simulated second", path, config.record_fps);
+}
+
+void MjSimImpl::stopRecording()
+{
+  std::shared_ptr<MjVideoWriter> recorder;
+  {
+    std::lock_guard<std::mutex> lock(rendering_mutex_);
+    recorder = std::move(recorder_);
+  }
 }
 
 void MjSimImpl::resetSimulation(const std::map<std::string, std::vector<double>> & reset_qs,
                                 const std::map<std::string, sva::PTransformd> & reset_pos)
 {
   iterCount_ = 0;
+  command_idx_ = 0;
+  next_record_t_ = 0.0;
+  for(auto & camera : cameras_)
+  {
+    camera->next_t = 0.0;
+  }
+  next_checkpoint_t_ = config.checkpoint_period;
   reset_simulation_ = false;
   if(controller)
   {
@@ -761,12 +1205,220 @@ void MjSimImpl::resetSimulation(const std::map<std::string, std::vector<double>>
     controller->running = true;
   }
   mj_resetData(model, data);
+  state_version_++;
+  static_geoms_valid_ = false;
   setSimulationInitialState();
+  if(settled_state_)
+  {
+    applySettledState();
+  }
   makeDatastoreCalls();
 }
 
+void MjSimImpl::saveCheckpoint()
+{
+  if(!checkpoint_writer_)
+  {
+    checkpoint_writer_ = std::make_unique<MjCheckpointWriter>();
+  }
+  auto checkpoint = checkpoint_writer_->acquire();
+  if(!checkpoint)
+  {
+    // The previous checkpoint is still being written, try again on the next step
+    return;
+  }
+  checkpoint_requested_ = false;
+  checkpoint->iterCount = iterCount_;
+  checkpoint->physics.save(*model, *data);
+  checkpoint->robots.resize(robots.size());
+  for(size_t i = 0; i < robots.size(); ++i)
+  {
+    checkpoint->robots[i].save(robots[i]);
+  }
+  checkpoint_writer_->submit(config.checkpoint_path);
+  if(config.checkpoint_period > 0)
+  {
+    next_checkpoint_t_ = data->time + config.checkpoint_period;
+  }
+}
+
+void MjSimImpl::loadCheckpoint(const std::string & path)
+{
+  MjCheckpoint checkpoint;
+  checkpoint.read(path);
+  checkpoint.physics.restore(*model, *data);
+  mj_forward(model, data);
+  iterCount_ = checkpoint.iterCount;
+  if(command_playback_)
+  {
+    // One row of references is played every frameskip_ iterations starting with the first one
+    command_idx_ = std::min((iterCount_ + frameskip_ - 1) / frameskip_, command_playback_->size());
+  }
+  next_checkpoint_t_ = data->time + config.checkpoint_period;
+  updateData();
+  captureLogData();
+  if(controller)
+  {
+    // mc_rtc cannot restore the controller, re-initialize it from the restored robots' state
+    std::map<std::string, std::vector<double>> qs;
+    std::map<std::string, sva::PTransformd> pos;
+    for(const auto & r : robots)
+    {
+      qs[r.name] = r.encoders;
+      pos[r.name] = r.root_qpos_idx != -1 ? r.root_posW_gt : controller->robot(r.name).posW();
+    }
+    controller->reset(qs, pos);
+    controller->running = true;
+  }
+  for(const auto & r_state : checkpoint.robots)
+  {
+    auto it = std::find_if(robots.begin(), robots.end(), [&](const MjRobot & r) { return r.name == r_state.name; });
+    if(it == robots.end())
+    {
+      mc_rtc::log::warning("[mc_mujoco] Robot {} in checkpoint {} is not in the simulation", r_state.name, path);
+      continue;
+    }
+    r_state.restore(*it);
+  }
+  mc_rtc::log::success("[mc_mujoco] Resumed simulation from {} at t = {:.3f}s", path, data->time);
+}
+
+void MjSimImpl::settleSimulation()
+{
+  // The cache is keyed by the scene, the initial configuration and the settling time
+  std::string key;
+  {
+    std::ifstream ifs(model_path);
+    key.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+  }
+  auto append_key = [&key](const void * ptr, size_t size) { key.append(static_cast<const char *>(ptr), size); };
+  append_key(qInit.data(), qInit.size() * sizeof(double));
+  append_key(alphaInit.data(), alphaInit.size() * sizeof(double));
+  append_key(model->body_pos, 3 * model->nbody * sizeof(mjtNum));
+  append_key(model->body_quat, 4 * model->nbody * sizeof(mjtNum));
+  append_key(&config.settle_time, sizeof(double));
+  int version = mj_version();
+  append_key(&version, sizeof(int));
+  auto cache_path =
+      (bfs::path(USER_FOLDER) / "cache" / fmt::format("settle_{:016x}.bin", std::hash<std::string>{}(key))).string();
+
+  MjCheckpoint settled;
+  if(bfs::exists(cache_path))
+  {
+    try
+    {
+      settled.read(cache_path);
+    }
+    catch(const std::runtime_error &)
+    {
+      settled.physics = {};
+    }
+  }
+  if(settled.physics.matches(*model))
+  {
+    mc_rtc::log::info("[mc_mujoco] Settled initial state loaded from {}", cache_path);
+  }
+  else
+  {
+    mc_rtc::log::info("[mc_mujoco] Settling the scene for {}s", config.settle_time);
+    size_t nsteps = std::ceil(config.settle_time / model->opt.timestep);
+    for(size_t i = 0; i < nsteps; ++i)
+    {
+      for(auto & r : robots)
+      {
+        // Hold the initial configuration
+        r.updateSensors(nullptr, model, data);
+        r.sendControl(*model, *data, 0, 1, false);
+      }
+      mj_step(model, data);
+    }
+    data->time = 0.0;
+    settled.physics.save(*model, *data);
+    if(settled.write(cache_path))
+    {
+      mc_rtc::log::success("[mc_mujoco] Settled initial state saved to {}", cache_path);
+    }
+  }
+  settled_state_ = settled.physics;
+  applySettledState();
+}
+
+void MjSimImpl::applySettledState()
+{
+  settled_state_->restore(*model, *data);
+  mj_forward(model, data);
+  captureLogData();
+  for(auto & r : robots)
+  {
+    r.updateSensors(nullptr, model, data);
+    for(size_t i = 0; i < r.mj_next_ctrl_q.size(); ++i)
+    {
+      auto rjo_idx = r.mj_jnt_to_rjo[i];
+      if(rjo_idx != -1)
+      {
+        r.mj_prev_ctrl_q[i] = r.encoders[rjo_idx];
+        r.mj_next_ctrl_q[i] = r.encoders[rjo_idx];
+      }
+    }
+    if(controller && r.root_qpos_idx != -1)
+    {
+      controller->controller().robots().robot(r.name).posW(r.root_posW_gt);
+    }
+  }
+}
+
+bool MjSimImpl::playbackStep()
+{
+  if(reset_simulation_)
+  {
+    reset_simulation_ = false;
+    playback_idx_ = 0;
+    playback_stats_ = {};
+    playback_done_ = false;
+  }
+  auto start_step = clock::now();
+  if(playback_done_ || (config.step_by_step && rem_steps == 0))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return playback_done_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(rendering_mutex_);
+    log_playback_->apply(playback_idx_, *model, *data);
+    mj_kinematics(model, data);
+    mj_comPos(model, data);
+    mj_collision(model, data);
+    state_version_++;
+    recordFrame();
+  }
+  playback_stats_.update(*data);
+  if(config.step_by_step)
+  {
+    rem_steps--;
+  }
+  if(++playback_idx_ == log_playback_->size())
+  {
+    playback_done_ = true;
+    const auto & stats = playback_stats_;
+    mc_rtc::log::success("[mc_mujoco] Played {} frames, {} frames in contact, {} contacts (max {} in one frame)",
+                         stats.frames, stats.frames_in_contact, stats.contacts, stats.max_ncon);
+    mc_rtc::log::success("[mc_mujoco] {} penetrating contacts, mean depth: {:.4f}m, max depth: {:.4f}m at t = {:.3f}s",
+                         stats.penetrations, stats.mean_penetration(), stats.max_penetration,
+                         stats.max_penetration_t);
+  }
+  if(config.playback_speed > 0)
+  {
+    std::this_thread::sleep_until(start_step + duration_us(1e6 * log_playback_->dt() / config.playback_speed));
+  }
+  return playback_done_;
+}
+
 bool MjSimImpl::stepSimulation()
 {
+  if(log_playback_)
+  {
+    return playbackStep();
+  }
   if(reset_simulation_)
   {
     resetSimulation(init_qs_, init_pos_);
@@ -792,13 +1444,23 @@ bool MjSimImpl::stepSimulation()
     mj_sim_dt[(iterCount_ - 1) % mj_sim_dt.size()] = dt.count();
   }
   mj_sim_start_t = start_step;
-  auto do_step = [this, &start_step]() {
+  auto do_step = [this]() {
+    clock::time_point step_end;
     {
       std::lock_guard<std::mutex> lock(rendering_mutex_);
+      auto step_start = clock::now();
       simStep();
+      step_end = clock::now();
+      log_data.step_dt = duration_ms(step_end - step_start).count();
     }
     updateData();
-    return controlStep();
+    captureLogData();
+    auto control_start = clock::now();
+    log_data.sensors_dt = duration_ms(control_start - step_end).count();
+    bool done = controlStep();
+    log_data.control_dt = duration_ms(clock::now() - control_start).count();
+    plotter_.capture(data->time);
+    return done;
   };
   bool done = false;
   if(!config.step_by_step)
@@ -815,6 +1477,10 @@ bool MjSimImpl::stepSimulation()
     }
     rem_steps--;
   }
+  if(checkpoint_requested_ || (config.checkpoint_period > 0 && data->time >= next_checkpoint_t_))
+  {
+    saveCheckpoint();
+  }
   if(config.sync_real_time)
   {
     std::this_thread::sleep_until(start_step + duration_us(1e6 * model->opt.timestep) + mj_sync_delay);
@@ -822,30 +1488,241 @@ bool MjSimImpl::stepSimulation()
   return done;
 }
 
+bool MjSimImpl::waitForFrame()
+{
+  auto wait_until = [](const clock::time_point & t) {
+    for(auto now = clock::now(); now < t; now = clock::now())
+    {
+      glfwWaitEventsTimeout(duration_us(t - now).count() * 1e-6);
+    }
+  };
+  if(glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+  {
+    glfwWaitEventsTimeout(0.1);
+    return false;
+  }
+  double fps = config.max_fps;
+  if(config.background_fps > 0 && !glfwGetWindowAttrib(window, GLFW_FOCUSED))
+  {
+    fps = fps > 0 ? std::min(fps, config.background_fps) : config.background_fps;
+  }
+  if(fps > 0)
+  {
+    wait_until(last_frame_t_ + duration_us(1e6 / fps));
+  }
+  profiler_.start();
+  glfwPollEvents();
+  profiler_.mark(MjRenderProfiler::Events);
+  // Redraw at least twice per second to keep the GUI up-to-date, and on every frame until the assets are uploaded
+  auto now = clock::now();
+  bool changed = redraw_frames > 0 || !asset_upload.done() || state_version_ != rendered_version_
+                 || now - last_frame_t_ > duration_ms(500)
+                 || std::memcmp(&camera, &rendered_camera_, sizeof(mjvCamera)) != 0
+                 || std::memcmp(&options, &rendered_options_, sizeof(mjvOption)) != 0
+                 || std::memcmp(&pert, &rendered_pert_, sizeof(mjvPerturb)) != 0;
+  if(!changed)
+  {
+    // Sleep until an event arrives or the simulation might have moved
+    glfwWaitEventsTimeout(fps > 0 ? 1.0 / fps : 1.0 / 60.0);
+    return false;
+  }
+  frame_start_t_ = clock::now();
+  redraw_frames = std::max(redraw_frames - 1, 0);
+  rendered_version_ = state_version_;
+  std::memcpy(&rendered_camera_, &camera, sizeof(mjvCamera));
+  std::memcpy(&rendered_options_, &options, sizeof(mjvOption));
+  std::memcpy(&rendered_pert_, &pert, sizeof(mjvPerturb));
+  double dt = duration_us(now - last_frame_t_).count() * 1e-6;
+  render_fps_ = 0.9 * render_fps_ + 0.1 / std::max(dt, 1e-3);
+  last_frame_t_ = now;
+  return true;
+}
+
+void MjSimImpl::updateSceneGeoms()
+{
+  // Skins and flexes are only updated by mjv_updateScene
+  bool incremental = model->nskin == 0;
+#if mjVERSION_HEADER >= 300
+  incremental = incremental && model->nflex == 0;
+#endif
+  if(!incremental)
+  {
+    mjv_updateScene(model, data, &options, &pert, &camera, mjCAT_ALL, &scene);
+    addEnvironmentGeoms();
+    return;
+  }
+  if(!static_geoms_valid_ || pert.select != static_select_
+     || std::memcmp(&options, &static_options_, sizeof(mjvOption)) != 0)
+  {
+    scene.ngeom = 0;
+    mjv_addGeoms(model, data, &options, &pert, mjCAT_STATIC, &scene);
+    static_geoms_.assign(scene.geoms, scene.geoms + scene.ngeom);
+    std::memcpy(&static_options_, &options, sizeof(mjvOption));
+    static_select_ = pert.select;
+    static_geoms_valid_ = true;
+  }
+  else
+  {
+    std::copy(static_geoms_.begin(), static_geoms_.end(), scene.geoms);
+    scene.ngeom = static_cast<int>(static_geoms_.size());
+  }
+  mjv_addGeoms(model, data, &options, &pert, mjCAT_DYNAMIC | mjCAT_DECOR, &scene);
+  addEnvironmentGeoms();
+  mjv_makeLights(model, data, &scene);
+  mjv_updateCamera(model, data, &camera, &scene);
+}
+
+bool MjSimImpl::showEnvironments(std::vector<std::vector<double>> qpos, double spacing)
+{
+  for(size_t i = 0; i < qpos.size(); ++i)
+  {
+    if(qpos[i].size() != static_cast<size_t>(model->nq))
+    {
+      mc_rtc::log::error("[mc_mujoco] Environment {} has {} positions but the model has {}", i, qpos[i].size(),
+                         model->nq);
+      return false;
+    }
+  }
+  std::lock_guard<std::mutex> lock(envs_mutex_);
+  envs_pending_ = Environments{std::move(qpos), spacing};
+  return true;
+}
+
+void MjSimImpl::addEnvironmentGeoms()
+{
+  {
+    std::lock_guard<std::mutex> lock(envs_mutex_);
+    if(envs_pending_)
+    {
+      envs_ = std::move(*envs_pending_);
+      envs_pending_.reset();
+      env_geoms_valid_ = false;
+    }
+  }
+  if(envs_.qpos.empty())
+  {
+    return;
+  }
+  if(env_geoms_valid_ && std::memcmp(&options, &env_options_, sizeof(mjvOption)) == 0)
+  {
+    int n = std::min(static_cast<int>(env_geoms_.size()), scene.maxgeom - scene.ngeom);
+    std::copy(env_geoms_.begin(), env_geoms_.begin() + n, scene.geoms + scene.ngeom);
+    // A full scene is grown by updateScene
+    scene.ngeom = n < static_cast<int>(env_geoms_.size()) ? scene.maxgeom : scene.ngeom + n;
+    return;
+  }
+  if(!env_data_)
+  {
+    env_data_ = mj_makeData(model);
+    mjv_defaultPerturb(&env_pert_);
+  }
+  // The simulation is the first tile of a square grid
+  size_t columns = static_cast<size_t>(std::ceil(std::sqrt(envs_.qpos.size() + 1)));
+  int start = scene.ngeom;
+  for(size_t i = 0; i < envs_.qpos.size(); ++i)
+  {
+    mju_copy(env_data_->qpos, envs_.qpos[i].data(), model->nq);
+    mj_fwdPosition(model, env_data_);
+    int first = scene.ngeom;
+    mjv_addGeoms(model, env_data_, &options, &env_pert_, mjCAT_DYNAMIC, &scene);
+    float offset[2] = {static_cast<float>(envs_.spacing * ((i + 1) % columns)),
+                       static_cast<float>(envs_.spacing * ((i + 1) / columns))};
+    for(int g = first; g < scene.ngeom; ++g)
+    {
+      scene.geoms[g].pos[0] += offset[0];
+      scene.geoms[g].pos[1] += offset[1];
+    }
+  }
+  env_geoms_.assign(scene.geoms + start, scene.geoms + scene.ngeom);
+  std::memcpy(&env_options_, &options, sizeof(mjvOption));
+  env_geoms_valid_ = scene.ngeom < scene.maxgeom;
+}
+
 void MjSimImpl::updateScene()
 {
+  if(!config.with_visualization)
+  {
+    // Nothing to draw, leave the CPU to the simulation
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return;
+  }
+  skip_frame_ = !waitForFrame();
+  if(skip_frame_)
+  {
+    return;
+  }
+
   // update scene and render
   std::lock_guard<std::mutex> lock(rendering_mutex_);
-  mjv_updateScene(model, data, &options, &pert, &camera, mjCAT_ALL, &scene);
-
-  if(client)
+  profiler_.mark(MjRenderProfiler::Lock);
+  if(recorder_ && config.record_camera.empty())
   {
-    client->updateScene(scene);
+    record_camera_ = camera;
   }
-
-  // process pending GUI events, call GLFW callbacks
-  glfwPollEvents();
+  updateSceneGeoms();
+  if(scene.ngeom >= scene.maxgeom)
+  {
+    // MuJoCo dropped some geoms, grow the scene and update it again
+    int maxgeom = 2 * scene.maxgeom;
+    mc_rtc::log::warning("[mc_mujoco] Scene is full ({} geoms), growing it to {} geoms", scene.maxgeom, maxgeom);
+    mjv_freeScene(&scene);
+    mjv_makeScene(model, &scene, maxgeom);
+    static_geoms_valid_ = false;
+    env_geoms_valid_ = false;
+    updateSceneGeoms();
+  }
+  if(!mesh_lod_.empty())
+  {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    mesh_lod_.filter(*model, scene, height);
+  }
+  viewports_.updateCameras(*model, *data, scene);
+  profiler_.mark(MjRenderProfiler::Scene);
 }
 
 bool MjSimImpl::render()
 {
   if(!config.with_visualization)
   {
-    return true;
+    return !playback_done_;
+  }
+  if(skip_frame_)
+  {
+    return !glfwWindowShouldClose(window);
+  }
+
+  if(!asset_upload.done())
+  {
+    asset_upload.update(model, context, 1e-3 * config.asset_upload_budget);
   }
 
   // mj render
-  mjr_render(uistate.rect[0], &scene, &context);
+  scene.flags[mjRND_SHADOW] = quality_.shadows();
+  scene.flags[mjRND_REFLECTION] = quality_.reflections();
+  scene.flags[mjRND_SKYBOX] = quality_.skybox();
+  const auto & rect = uistate.rect[0];
+  double scale = quality_.scale();
+  if(scale < 1.0)
+  {
+    mjrRect scaled = {0, 0, std::min(static_cast<int>(scale * rect.width), context.offWidth),
+                      std::min(static_cast<int>(scale * rect.height), context.offHeight)};
+    mjr_setBuffer(mjFB_OFFSCREEN, &context);
+    mjr_render(scaled, &scene, &context);
+    if(!mujoco_upscale_offscreen(context, scaled, rect))
+    {
+      mc_rtc::log::error("[mc_mujoco] The depth of the scaled scene cannot be copied to the window, the scene will be "
+                         "rendered at full resolution");
+      quality_.scaling = false;
+    }
+    mjr_setBuffer(mjFB_WINDOW, &context);
+    glViewport(rect.left, rect.bottom, rect.width, rect.height);
+  }
+  else
+  {
+    mjr_render(rect, &scene, &context);
+  }
+  profiler_.mark(MjRenderProfiler::Render);
 
   // Render ImGui
   ImGui_ImplOpenGL3_NewFrame();
@@ -855,12 +1732,25 @@ bool MjSimImpl::render()
   ImGuiIO & io = ImGui::GetIO();
   ImGuizmo::AllowAxisFlip(false);
   ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
+  profiler_.mark(MjRenderProfiler::ImGui);
   if(client)
   {
-    client->update();
+    // The widgets keep their data and cached geometry between updates, they are redrawn on every frame
+    if(config.gui_update_rate <= 0 || frame_start_t_ - last_gui_update_t_ >= duration_us(1e6 / config.gui_update_rate))
+    {
+      last_gui_update_t_ = frame_start_t_;
+      client->update();
+    }
+    profiler_.mark(MjRenderProfiler::ClientUpdate);
     client->draw2D(window);
+    profiler_.mark(MjRenderProfiler::Draw2D);
+    client->batch().thin_lines = quality_.thin_lines();
     client->draw3D();
+    profiler_.mark(MjRenderProfiler::Draw3D);
   }
+  // Secondary views are drawn after the GUI client since it reads the main view's matrices from the OpenGL state
+  viewports_.render(scene, context, rect);
+  profiler_.mark(MjRenderProfiler::Render);
   {
     auto right_margin = 5.0f;
     auto top_margin = 5.0f;
@@ -879,8 +1769,24 @@ bool MjSimImpl::render()
     {
       mj_sim_dt_average += mj_sim_dt[i] / nsamples;
     }
-    ImGui::Text("Average sim time: %.2fμs", mj_sim_dt_average);
-    ImGui::Text("Simulation/Real time: %.2f", mj_sim_dt_average / (1e6 * model->opt.timestep));
+    if(log_playback_)
+    {
+      const auto & stats = playback_stats_;
+      ImGui::Text("Playback: %zu/%zu", playback_idx_, log_playback_->size());
+      ImGui::InputDouble("Playback speed", &config.playback_speed, 0.5, 1.0, "%.1f");
+      ImGui::Text("Contacts: %d (max %d)", data->ncon, stats.max_ncon);
+      ImGui::Text("Max penetration: %.4fm at t = %.3fs", stats.max_penetration, stats.max_penetration_t);
+      ImGui::Text("Mean penetration: %.4fm", stats.mean_penetration());
+    }
+    else
+    {
+      ImGui::Text("Average sim time: %.2fμs", mj_sim_dt_average);
+      ImGui::Text("Simulation/Real time: %.2f", mj_sim_dt_average / (1e6 * model->opt.timestep));
+    }
+    if(!asset_upload.done())
+    {
+      ImGui::Text("Loading assets: %zu/%zu", asset_upload.uploaded(), asset_upload.total());
+    }
     if(ImGui::Checkbox("Sync with real-time", &config.sync_real_time))
     {
       if(config.sync_real_time)
@@ -930,6 +1836,19 @@ bool MjSimImpl::render()
         ImGui::SameLine();
       }
     };
+    ImGui::Text("Rendering: %.1f FPS (%.1fms per frame)", render_fps_, quality_.frame_ms);
+    ImGui::InputDouble("Target FPS", &config.target_fps, 5.0, 10.0, "%.0f");
+    ImGui::Text("Quality: %s", quality_.description());
+    ImGui::Text("Scene geoms: %d/%d", scene.ngeom, scene.maxgeom);
+    if(client)
+    {
+      const auto & batch = client->batch();
+      ImGui::Text("GUI: %zu lines, %zu triangles, %zu meshes", batch.lines(), batch.triangles(), batch.meshes());
+      ImGui::Text("GUI elements: %zu cached, %zu regenerated, %zu culled", batch.reused(), batch.regenerated(),
+                  client->culled());
+      ImGui::InputDouble("GUI LOD distance", &client->lod_distance, 1.0, 5.0, "%.1f");
+      ImGui::SliderFloat("GUI line width", &client->batch().line_width, 1.0f, 10.0f, "%.1f");
+    }
     ImGui::Text("%s", fmt::format("Visible layers [0-{}]", mjNGROUP).c_str());
     for(size_t i = 0; i < mjNGROUP; ++i)
     {
@@ -939,13 +1858,84 @@ bool MjSimImpl::render()
     {
       reset_simulation_ = true;
     }
+    if(ImGui::Button("Save checkpoint", ImVec2(-FLT_MIN, 0.0f)))
+    {
+      checkpoint_requested_ = true;
+    }
+    bool recording = recorder_ != nullptr;
+    if(ImGui::Checkbox("Record", &recording))
+    {
+      if(recording)
+      {
+        try
+        {
+          auto path =
+              config.record_path.size() ? config.record_path : fmt::format("/tmp/mc_mujoco_{}.y4m", std::time(nullptr));
+          startRecording(path);
+        }
+        catch(const std::runtime_error &)
+        {
+          // The error has been logged
+        }
+      }
+      else
+      {
+        stopRecording();
+      }
+    }
+    if(recorder_)
+    {
+      ImGui::Text("%zu frames recorded (%zu dropped)", recorder_->frames(), recorder_->dropped());
+    }
+    if(ImGui::CollapsingHeader("Views"))
+    {
+      viewports_.drawUI(*model, camera, pert.select);
+    }
+    if(ImGui::CollapsingHeader("Environments"))
+    {
+      ImGui::Text("%zu environments shown", envs_.qpos.size());
+      double spacing = envs_.spacing;
+      if(ImGui::InputDouble("Spacing", &spacing, 0.5, 1.0, "%.1f") && spacing > 0)
+      {
+        showEnvironments(envs_.qpos, spacing);
+      }
+      if(ImGui::Button("Add snapshot"))
+      {
+        auto qpos = envs_.qpos;
+        {
+          std::lock_guard<std::mutex> lock(rendering_mutex_);
+          qpos.emplace_back(data->qpos, data->qpos + model->nq);
+        }
+        showEnvironments(std::move(qpos), envs_.spacing);
+      }
+      ImGui::SameLine();
+      if(ImGui::Button("Clear"))
+      {
+        showEnvironments({}, envs_.spacing);
+      }
+    }
+    if(ImGui::CollapsingHeader("Render profiler"))
+    {
+      profiler_.draw();
+    }
+    ImGui::Checkbox("Plots", &show_plots_);
     ImGui::End();
   }
+  plotter_.update();
+  if(show_plots_)
+  {
+    plotter_.draw(&show_plots_);
+  }
   ImGui::Render();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  profiler_.mark(MjRenderProfiler::ImGui);
+
+  quality_.update(duration_ms(clock::now() - frame_start_t_).count(), config.target_fps);
 
   // swap OpenGL buffers (blocking call due to v-sync)
   glfwSwapBuffers(window);
+  profiler_.mark(MjRenderProfiler::Swap);
+  profiler_.end();
 
   return !glfwWindowShouldClose(window);
 }
@@ -1031,6 +2021,11 @@ bool MjSim::render()
   return impl->render();
 }
 
+bool MjSim::showEnvironments(const std::vector<std::vector<double>> & qpos, double spacing)
+{
+  return impl->showEnvironments(qpos, spacing);
+}
+
 mc_control::MCGlobalController * MjSim::controller() noexcept
 {
   return impl->get_controller();
@@ -50,6 +50,18 @@ public:
    */
   bool render();
 
+  /** Show other states of the simulated model next to the simulation
+   *
+   * Each state is the qpos of the MuJoCo model. The states are drawn in a grid around the simulation, spacing meters
+   * apart, in the same render pass as the simulation. They are copied so the caller can keep stepping its
+   * environments while they are displayed. An empty vector removes the environments.
+   *
+   * Only the moving bodies of the model are drawn for each state, the static geoms (e.g. the floor) are shared.
+   *
+   * \returns False if a state does not match the model
+   */
+  bool showEnvironments(const std::vector<std::vector<double>> & qpos, double spacing = 2.0);
+
   /** The underlying global controller instance in the simulation
    *
    * nullptr if with_controller was false in MjConfiguration
@@ -3,10 +3,23 @@
 #include "mj_sim.h"
 
 #include "MujocoClient.h"
+#include "mj_asset_upload.h"
+#include "mj_checkpoint.h"
+#include "mj_command_playback.h"
+#include "mj_log_playback.h"
+#include "mj_mesh_lod.h"
+#include "mj_offscreen.h"
+#include "mj_plotter.h"
+#include "mj_render_profiler.h"
+#include "mj_render_quality.h"
+#include "mj_video.h"
+#include "mj_viewports.h"
 
 #include "mujoco.h"
 
+#include <atomic>
 #include <condition_variable>
+#include <optional>
 
 namespace mc_mujoco
 {
@@ -27,6 +40,68 @@ struct MjObject
   sva::PTransformd init_pose;
 };
 
+/** Camera of a robot rendered offscreen and published to the controller
+ *
+ * Defined in the robot's mc_mujoco configuration:
+ *
+ * cameras:
+ *   - name: head_camera # camera in the robot's MuJoCo model
+ *     width: 640
+ *     height: 480
+ *     rate: 30 # images per simulated second
+ *     depth: true
+ *     segmentation: false
+ *
+ * The images are published as std::shared_ptr<const MjImage> in the datastore under "MuJoCo::<robot>::<name>"
+ */
+struct MjCameraSensor
+{
+  /** Robot in mc_rtc */
+  std::string robot;
+  /** Camera name (without the robot prefix) */
+  std::string name;
+  /** Camera id in MuJoCo */
+  int camera_id = -1;
+  int width = 640;
+  int height = 480;
+  /** Images per simulated second */
+  double rate = 30.0;
+  MjImageOutputs outputs;
+  /** Simulation time of the next image */
+  double next_t = 0.0;
+  /** Latest image delivered by the renderer, published on the next step */
+  std::mutex mutex;
+  std::shared_ptr<const MjImage> latest;
+
+  inline std::string datastore_key() const
+  {
+    return fmt::format("MuJoCo::{}::{}", robot, name);
+  }
+};
+
+/** Simulation data added to the mc_rtc log
+ *
+ * The simulation loop writes into these slots in place, the logger callbacks only read them when the controller logs
+ * so that no formatting or allocation happens on the physics path
+ */
+struct MjSimLogData
+{
+  /** Time spent in the last physics step (ms) */
+  double step_dt = 0.0;
+  /** Time spent reading the sensors in the last step (ms) */
+  double sensors_dt = 0.0;
+  /** Time spent in the last control step, including the controller run (ms) */
+  double control_dt = 0.0;
+  /** Number of active contacts */
+  int ncon = 0;
+  /** Number of constraint solver iterations in the last step */
+  int solver_iter = 0;
+  /** Body on which a mouse perturbation is applied, -1 if there is none */
+  int perturbation_body = -1;
+  /** Wrench applied by the mouse perturbation (world frame, at the body's center of mass) */
+  sva::ForceVecd perturbation = sva::ForceVecd::Zero();
+};
+
 /** Interface between a Mujoco robot and an mc_rtc robot */
 struct MjRobot
 {
@@ -56,6 +131,8 @@ struct MjRobot
   Eigen::Vector3d root_linacc;
   /** Angular acceleration of FloatingBase sensor */
   Eigen::Vector3d root_angacc;
+  /** Ground-truth pose of the root body in MuJoCo */
+  sva::PTransformd root_posW_gt = sva::PTransformd::Identity();
   /** Encoders in robot.ref_joint_order */
   std::vector<double> encoders;
   /** Joints' velocity in robot.ref_joint_order */
@@ -177,6 +254,9 @@ public:
   /** MuJoCo data */
   mjData * data = nullptr;
 
+  /** Path to the merged MuJoCo model */
+  std::string model_path;
+
   /** Initial state */
   std::vector<double> qInit;
 
@@ -201,6 +281,9 @@ public:
   /** GPU context */
   mjrContext context;
 
+  /** Meshes and textures that remain to be uploaded to the GPU context */
+  MjAssetUpload asset_upload;
+
   /** Keyboard and mouse states */
   mjuiState uistate;
 
@@ -216,6 +299,12 @@ public:
   /** Number of steps left to play in step by step mode */
   size_t rem_steps = 0;
 
+  /** Number of frames that must be drawn regardless of changes, set by input events */
+  int redraw_frames = 1;
+
+  /** Simulation data committed to the controller's log */
+  MjSimLogData log_data;
+
   /** Robots in simulation and mc_rtc */
   std::vector<MjRobot> robots;
 
@@ -231,6 +320,137 @@ private:
   /** True if the simulation should be reset on the next step */
   bool reset_simulation_ = false;
 
+  /** True if a checkpoint should be saved on the next step, set from the GUI and datastore callers */
+  std::atomic<bool> checkpoint_requested_{false};
+  /** Simulation time of the next periodic checkpoint */
+  double next_checkpoint_t_ = 0.0;
+  /** Writes checkpoints in the background, created on the first checkpoint */
+  std::unique_ptr<MjCheckpointWriter> checkpoint_writer_;
+
+  /** State reached after settling the scene, used as the initial state when settle_time is set */
+  std::optional<MjPhysicsState> settled_state_;
+
+  /** Kinematic playback of an mc_rtc log, null if config.playback_log is empty */
+  std::unique_ptr<MjLogPlayback> log_playback_;
+  /** Next sample played from the log */
+  size_t playback_idx_ = 0;
+  /** Contact statistics of the playback */
+  MjPlaybackStats playback_stats_;
+  /** True once the whole log has been played */
+  bool playback_done_ = false;
+
+  /** Open-loop references played instead of the controller output, null if config.command_file is empty */
+  std::unique_ptr<MjCommandPlayback> command_playback_;
+  /** Next control step played from the command file */
+  size_t command_idx_ = 0;
+
+  /** Incremented every time the simulation state changes */
+  std::atomic<uint64_t> state_version_{0};
+  /** State version, camera, options and perturbation drawn in the last frame */
+  uint64_t rendered_version_ = 0;
+  mjvCamera rendered_camera_;
+  mjvOption rendered_options_;
+  mjvPerturb rendered_pert_;
+  /** Time at which the last frame was started */
+  clock::time_point last_frame_t_;
+  /** True if nothing changed since the last frame, updateScene and render do nothing */
+  bool skip_frame_ = false;
+  /** Measured rendering rate */
+  double render_fps_ = 0.0;
+  /** Time at which the work on the current frame started, excludes the wait for the next frame */
+  clock::time_point frame_start_t_;
+  /** Time of the last GUI client update */
+  clock::time_point last_gui_update_t_;
+  /** Adjusts the rendering quality to hold config.target_fps */
+  MjQualityGovernor quality_;
+  /** Timing of the render thread phases */
+  MjRenderProfiler profiler_;
+  /** Secondary views drawn on top of the main view */
+  MjViewports viewports_;
+  /** Live plots of the simulation signals */
+  MjPlotter plotter_;
+  bool show_plots_ = false;
+  /** Levels of detail of the visual meshes, see the mesh_lod option */
+  MjMeshLOD mesh_lod_;
+
+  /** Register the joints, actuators, sensors, contacts and timings in the plotter */
+  void loadPlotChannels();
+
+  /** Geoms of the static bodies, rebuilt when the options, the selection or the simulation are reset */
+  std::vector<mjvGeom> static_geoms_;
+  mjvOption static_options_;
+  int static_select_ = -1;
+  std::atomic<bool> static_geoms_valid_{false};
+
+  /** States shown next to the simulation, see MjSim::showEnvironments */
+  struct Environments
+  {
+    std::vector<std::vector<double>> qpos;
+    double spacing = 2.0;
+  };
+  /** Protects envs_pending_ */
+  std::mutex envs_mutex_;
+  /** States waiting to be picked up by the render thread */
+  std::optional<Environments> envs_pending_;
+  /** States being displayed (render thread) */
+  Environments envs_;
+  /** Geoms of the environments with their offset, rebuilt when the states or the options change */
+  std::vector<mjvGeom> env_geoms_;
+  mjvOption env_options_;
+  bool env_geoms_valid_ = false;
+  /** Kinematics of the environments, created on the first use */
+  mjData * env_data_ = nullptr;
+  /** No selection in the environments */
+  mjvPerturb env_pert_;
+
+  /** Add the geoms of the environments to the scene, must be called with rendering_mutex_ held */
+  void addEnvironmentGeoms();
+
+  /** Renders images without a window, null unless config.offscreen is set */
+  std::unique_ptr<MjOffscreenRenderer> offscreen_;
+  /** Visualization options and (unused) perturbation of the offscreen images */
+  mjvOption offscreen_options_;
+  mjvPerturb offscreen_pert_;
+
+  /** Create an offscreen renderer whose images are at most width x height
+   *
+   * The scene is updated from the simulation under rendering_mutex_ or from the state provided with the request
+   */
+  std::unique_ptr<MjOffscreenRenderer> makeOffscreenRenderer(int width, int height);
+
+  /** Create offscreen_ */
+  void createOffscreenRenderer();
+
+  /** Camera sensors of the robots */
+  std::vector<std::unique_ptr<MjCameraSensor>> cameras_;
+  /** Renders the camera sensors in its own thread, null if there is no camera sensor */
+  std::unique_ptr<MjOffscreenRenderer> camera_renderer_;
+
+  /** Create the camera sensors from the robots' configuration (robot name to "cameras" entry) */
+  void loadCameraSensors(const std::map<std::string, mc_rtc::Configuration> & configs);
+
+  /** Request the camera images that are due, must be called with rendering_mutex_ held */
+  void requestCameraImages();
+
+  /** Publish the latest camera images in the datastore */
+  void publishCameraImages();
+
+  /** Video being recorded, null when not recording */
+  std::shared_ptr<MjVideoWriter> recorder_;
+  /** Simulation time of the next recorded frame */
+  double next_record_t_ = 0.0;
+  /** Camera of the recording, copied from the viewer camera on every frame if config.record_camera is empty */
+  mjvCamera record_camera_;
+
+  /** Request a frame of the recording if it is due, must be called with rendering_mutex_ held */
+  void recordFrame();
+
+  /** Update the scene geoms, the static geoms are copied from static_geoms_ */
+  void updateSceneGeoms();
+
+  /** Wait until a new frame can be drawn, returns false if nothing changed since the last frame */
+  bool waitForFrame();
+
   /** Mutex used in rendering */
   std::mutex rendering_mutex_;
 
@@ -241,6 +461,10 @@ public:
 
   void makeDatastoreCalls();
 
+  void addLogEntries();
+
+  void captureLogData();
+
   void startSimulation();
 
   void updateData();
@@ -251,6 +475,9 @@ public:
 
   bool stepSimulation();
 
+  /** Play the next sample of the log, only the kinematics and collisions are computed */
+  bool playbackStep();
+
   void updateScene();
 
   bool render();
@@ -262,6 +489,38 @@ public:
 
   void setSimulationInitialState();
 
+  /** Copy the current state and write it to config.checkpoint_path in the background */
+  void saveCheckpoint();
+
+  /** Restore the simulation from a checkpoint and re-initialize the controller from the restored state */
+  void loadCheckpoint(const std::string & path);
+
+  /** Render the simulation from camera (a free camera looking at the model if empty) and save it to path (PPM)
+   *
+   * The image is rendered and written in the background
+   *
+   * \returns False if offscreen rendering is disabled, the camera does not exist or too many images are pending
+   */
+  bool saveImage(const std::string & path, const std::string & camera);
+
+  /** Start recording to path (see config.record_path), offscreen rendering is enabled if needed
+   *
+   * Must be called from the main thread
+   */
+  void startRecording(const std::string & path);
+
+  /** Stop the recording, the frames already captured are still written */
+  void stopRecording();
+
+  /** See MjSim::showEnvironments, can be called from any thread */
+  bool showEnvironments(std::vector<std::vector<double>> qpos, double spacing);
+
+  /** Let the scene settle without the controller, or restore the settled state from the cache */
+  void settleSimulation();
+
+  /** Start the robots from the current MuJoCo state */
+  void applySettledState();
+
   void saveGUISettings();
 
   inline mc_control::MCGlobalController * get_controller() noexcept
@@ -1,3 +1,5 @@
+#include <GL/glew.h>
+
 #include "glfw3.h"
 #include "mujoco.h"
 #include "uitools.h"
@@ -52,6 +54,8 @@ void uiLayout(mjuiState * state)
 void uiEvent(mjuiState * state)
 {
   auto mj_sim = static_cast<MjSimImpl *>(state->userdata);
+  // ImGui needs a couple of frames to react to an event
+  mj_sim->redraw_frames = 2;
 
   if(state->type == mjEVENT_KEY && ImGui::GetIO().WantCaptureKeyboard)
   {
@@ -287,7 +291,8 @@ bool mujoco_init(MjSimImpl * mj_sim,
 #endif
 
   // Load the model;
-  std::string model = merge_mujoco_models(mujocoObjects, mcrtcObjects, mj_sim->robots);
+  std::string model = merge_mujoco_models(mujocoObjects, mcrtcObjects, mj_sim->robots, mj_sim->config.mesh_lod);
+  mj_sim->model_path = model;
   char error[1000] = "Could not load XML model";
   mj_sim->model = mj_loadXML(model.c_str(), 0, error, 1000);
   if(!mj_sim->model)
@@ -302,6 +307,19 @@ bool mujoco_init(MjSimImpl * mj_sim,
   return true;
 }
 
+void mujoco_init_gl()
+{
+  // Otherwise GLEW skips the entry points that are not advertised in the extension string of the context
+  glewExperimental = GL_TRUE;
+  GLenum err = glewInit();
+  // GLEW built for GLX cannot query the display of an EGL context but the functions are still loaded
+  if(err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY)
+  {
+    mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLEW initialization failed: {}",
+                                                     reinterpret_cast<const char *>(glewGetErrorString(err)));
+  }
+}
+
 void mujoco_create_window(MjSimImpl * mj_sim)
 {
   // Initialize GLFW
@@ -321,6 +339,7 @@ void mujoco_create_window(MjSimImpl * mj_sim)
     mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] GLFW window creation failed");
   }
   glfwMakeContextCurrent(mj_sim->window);
+  mujoco_init_gl();
   glfwSwapInterval(1);
   glfwSetWindowUserPointer(mj_sim->window, static_cast<void *>(mj_sim));
 
@@ -364,9 +383,18 @@ void mujoco_create_window(MjSimImpl * mj_sim)
   mjv_defaultScene(&mj_sim->scene);
   mjr_defaultContext(&mj_sim->context);
 
+  // The offscreen buffer is used to render at a lower resolution, make it as large as the screen
+  const GLFWvidmode * vmode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+  if(vmode)
+  {
+    mj_sim->model->vis.global.offwidth = std::max(mj_sim->model->vis.global.offwidth, vmode->width);
+    mj_sim->model->vis.global.offheight = std::max(mj_sim->model->vis.global.offheight, vmode->height);
+  }
+
   // create scene and context
-  mjv_makeScene(mj_sim->model, &mj_sim->scene, 2000);
-  mjr_makeContext(mj_sim->model, &mj_sim->context, mjFONTSCALE_150);
+  mjv_makeScene(mj_sim->model, &mj_sim->scene, mj_sim->model->ngeom + mj_sim->config.scene_geom_budget);
+  // The meshes and textures are uploaded by the first frames so the window shows up immediately
+  mj_sim->asset_upload.start(mj_sim->model, mj_sim->context, mjFONTSCALE_150, mj_sim->config.asset_upload_budget > 0);
 
   // install GLFW event callback
   mj_sim->uistate.userdata = static_cast<void *>(mj_sim);
@@ -22,11 +22,14 @@ namespace mc_mujoco
  *
  * \param xmlFiles Individual models
  *
+ * \param meshLOD If true, add simplified levels of detail of the meshes (see mj_mesh_lod.h)
+ *
  * \returns The path to the generated model
  */
 std::string merge_mujoco_models(const std::map<std::string, std::string> & mujocoObjects,
                                 const std::map<std::string, std::string> & mcrtcObjects,
-                                std::vector<MjRobot> & mjRobots);
+                                std::vector<MjRobot> & mjRobots,
+                                bool meshLOD = false);
 
 /*! Load XML model and initialize */
 bool mujoco_init(MjSimImpl * mj_sim,
@@ -36,6 +39,9 @@ bool mujoco_init(MjSimImpl * mj_sim,
 /*! Create GLFW window */
 void mujoco_create_window(MjSimImpl * mj_sim);
 
+/** Load the OpenGL functions used by the GUI renderers, must be called once the first context is current */
+void mujoco_init_gl();
+
 /*! Sets initial qpos and qvel in mjData */
 bool mujoco_set_const(mjModel * m, mjData * d, const std::vector<double> & qpos, const std::vector<double> & qvel);
 
@@ -5,6 +5,7 @@ namespace bfs = boost::filesystem;
 
 #include <mc_rtc/logging.h>
 
+#include "mj_mesh_lod.h"
 #include "mj_sim_impl.h"
 
 namespace mc_mujoco
@@ -374,6 +375,94 @@ static void merge_mujoco_model(const std::string & robot, const std::string & xm
   }
 }
 
+static void set_attribute(pugi::xml_node & n, const char * attr, const std::string & value)
+{
+  auto n_attr = n.attribute(attr);
+  if(!n_attr)
+  {
+    n_attr = n.append_attribute(attr);
+  }
+  n_attr.set_value(value.c_str());
+}
+
+/** Add the simplified levels of the meshes (see mj_mesh_lod.h) as visual-only geoms next to the geoms using them */
+static void add_mesh_lods(pugi::xml_node & out)
+{
+  // Mesh name to the names of its simplified levels
+  std::map<std::string, std::vector<std::string>> lods;
+  auto asset = out.child("asset");
+  std::vector<pugi::xml_node> meshes;
+  for(const auto & mesh : asset.children("mesh"))
+  {
+    meshes.push_back(mesh);
+  }
+  for(auto & mesh : meshes)
+  {
+    auto file = mesh.attribute("file");
+    if(!file)
+    {
+      continue;
+    }
+    // MuJoCo names the meshes after their file by default
+    auto name_attr = mesh.attribute("name");
+    std::string name = name_attr ? name_attr.value() : bfs::path(file.value()).stem().string();
+    auto & names = lods[name];
+    auto previous = mesh;
+    for(size_t i = 0; i < MESH_LOD_RATIOS.size(); ++i)
+    {
+      auto path = mesh_lod(file.value(), MESH_LOD_RATIOS[i]);
+      if(path.empty())
+      {
+        break;
+      }
+      auto lod = asset.insert_copy_after(mesh, previous);
+      names.push_back(fmt::format("{}{}{}", name, MESH_LOD_SUFFIX, i + 1));
+      set_attribute(lod, "name", names.back());
+      set_attribute(lod, "file", path);
+      previous = lod;
+    }
+  }
+  size_t unnamed = 0;
+  std::function<void(pugi::xml_node &)> add_geoms = [&](pugi::xml_node & parent) {
+    std::vector<pugi::xml_node> children;
+    for(const auto & c : parent.children())
+    {
+      children.push_back(c);
+    }
+    for(auto & c : children)
+    {
+      if(std::string(c.name()) != "geom")
+      {
+        add_geoms(c);
+        continue;
+      }
+      auto it = lods.find(c.attribute("mesh").value());
+      if(it == lods.end() || it->second.empty())
+      {
+        continue;
+      }
+      if(!c.attribute("name"))
+      {
+        set_attribute(c, "name", fmt::format("mc_mujoco_lod_geom_{}", unnamed++));
+      }
+      std::string name = c.attribute("name").value();
+      auto previous = c;
+      for(size_t i = 0; i < it->second.size(); ++i)
+      {
+        auto lod = parent.insert_copy_after(c, previous);
+        set_attribute(lod, "name", fmt::format("{}{}{}", name, MESH_LOD_SUFFIX, i + 1));
+        set_attribute(lod, "mesh", it->second[i]);
+        set_attribute(lod, "contype", "0");
+        set_attribute(lod, "conaffinity", "0");
+        set_attribute(lod, "mass", "0");
+        previous = lod;
+      }
+    }
+  };
+  auto worldbody = out.child("worldbody");
+  add_geoms(worldbody);
+}
+
 static void get_joint_names(const pugi::xml_node & in,
                             const std::string & prefix,
                             std::vector<std::string> & joints,
@@ -480,7 +569,8 @@ static MjRobot mj_robot_from_xml(const std::string & name, const std::string & x
 
 std::string merge_mujoco_models(const std::map<std::string, std::string> & mujocoObjects,
                                 const std::map<std::string, std::string> & mcrtcObjects,
-                                std::vector<MjRobot> & mjRobots)
+                                std::vector<MjRobot> & mjRobots,
+                                bool meshLOD)
 {
   mjRobots.clear();
   std::string outFile = (bfs::temp_directory_path() / bfs::unique_path("mc_mujoco_%%%%-%%%%-%%%%-%%%%.xml")).string();
@@ -496,6 +586,10 @@ std::string merge_mujoco_models(const std::map<std::string, std::string> & mujoc
     merge_mujoco_model(name, xmlFile, out);
     mjRobots.push_back(mj_robot_from_xml(name, xmlFile, name));
   }
+  if(meshLOD)
+  {
+    add_mesh_lods(out);
+  }
   {
     std::ofstream ofs(outFile);
     out_doc.save(ofs, "    ");
@@ -0,0 +1,152 @@
+#include "mj_video.h"
+
+#include <mc_rtc/logging.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Maximum number of frames waiting to be written */
+constexpr size_t MAX_QUEUED_FRAMES = 64;
+
+inline uint8_t to_byte(double v) noexcept
+{
+  return static_cast<uint8_t>(std::min(std::max(std::lround(v), 0l), 255l));
+}
+
+} // namespace
+
+MjVideoWriter::MjVideoWriter(const std::string & path, double fps) : path_(path), fps_(fps)
+{
+  if(bfs::path(path).extension() == ".y4m")
+  {
+    video_ = fopen(path.c_str(), "wb");
+    if(!video_)
+    {
+      mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot write a video to {}", path);
+    }
+  }
+  else
+  {
+    boost::system::error_code ec;
+    bfs::create_directories(path, ec);
+    if(!bfs::is_directory(path))
+    {
+      mc_rtc::log::error_and_throw<std::runtime_error>("[mc_mujoco] Cannot create the recording directory {}", path);
+    }
+  }
+  thread_ = std::thread([this]() { run(); });
+}
+
+MjVideoWriter::~MjVideoWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+  if(video_)
+  {
+    fclose(video_);
+  }
+  mc_rtc::log::info("[mc_mujoco] Recorded {} frames to {} ({} dropped)", frames(), path_, dropped());
+}
+
+bool MjVideoWriter::push(MjImage && image)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(queue_.size() >= MAX_QUEUED_FRAMES)
+    {
+      dropped_++;
+      return false;
+    }
+    queue_.push_back(std::move(image));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void MjVideoWriter::run()
+{
+  while(true)
+  {
+    MjImage image;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if(queue_.empty())
+      {
+        // Only stop once every frame has been written
+        return;
+      }
+      image = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    write(image);
+  }
+}
+
+void MjVideoWriter::write(const MjImage & image)
+{
+  if(!video_)
+  {
+    auto frame = (bfs::path(path_) / fmt::format("frame_{:06d}.ppm", frames())).string();
+    if(!image.savePPM(frame))
+    {
+      mc_rtc::log::error("[mc_mujoco] Failed to write {}", frame);
+      dropped_++;
+      return;
+    }
+    frames_++;
+    return;
+  }
+  if(width_ == 0)
+  {
+    width_ = image.width;
+    height_ = image.height;
+    // Frame rate as a rational number with a millisecond precision
+    fprintf(video_, "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C444\n", width_, height_, std::lround(1000 * fps_));
+    yuv_.resize(3 * static_cast<size_t>(width_) * height_);
+  }
+  if(image.width != width_ || image.height != height_)
+  {
+    mc_rtc::log::error("[mc_mujoco] Recorded frame size changed ({}x{} instead of {}x{}), the frame is dropped",
+                       image.width, image.height, width_, height_);
+    dropped_++;
+    return;
+  }
+  // BT.601 full range conversion to planar YUV
+  size_t n = static_cast<size_t>(width_) * height_;
+  uint8_t * y = yuv_.data();
+  uint8_t * u = y + n;
+  uint8_t * v = u + n;
+  for(size_t i = 0; i < n; ++i)
+  {
+    double r = image.rgb[3 * i];
+    double g = image.rgb[3 * i + 1];
+    double b = image.rgb[3 * i + 2];
+    y[i] = to_byte(0.299 * r + 0.587 * g + 0.114 * b);
+    u[i] = to_byte(128.0 - 0.168736 * r - 0.331264 * g + 0.5 * b);
+    v[i] = to_byte(128.0 + 0.5 * r - 0.418688 * g - 0.081312 * b);
+  }
+  fputs("FRAME\n", video_);
+  if(fwrite(yuv_.data(), 1, yuv_.size(), video_) != yuv_.size())
+  {
+    mc_rtc::log::error("[mc_mujoco] Failed to write a frame to {}", path_);
+    dropped_++;
+    return;
+  }
+  frames_++;
+}
+
+} // namespace mc_mujoco
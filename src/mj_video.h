@@ -0,0 +1,93 @@
+#pragma once
+
+#include "mj_offscreen.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mc_mujoco
+{
+
+/** Writes recorded frames from a background thread
+ *
+ * If the path ends with .y4m the frames are written to an uncompressed YUV4MPEG2 video (4:4:4), otherwise the path is
+ * a directory where each frame is written as a PPM image (frame_000000.ppm, frame_000001.ppm...).
+ *
+ * Frames are only queued by the producer, the conversion and the disk I/O happen in the writer thread.
+ */
+struct MjVideoWriter
+{
+  /** Open the output
+   *
+   * \param fps Frame rate stored in the video header
+   *
+   * \throws std::runtime_error if the output cannot be created
+   */
+  MjVideoWriter(const std::string & path, double fps);
+
+  /** Write the remaining frames and close the output */
+  ~MjVideoWriter();
+
+  MjVideoWriter(const MjVideoWriter &) = delete;
+  MjVideoWriter & operator=(const MjVideoWriter &) = delete;
+
+  /** Queue a frame, never blocks
+   *
+   * \returns False if the writer is too far behind, the frame is dropped
+   */
+  bool push(MjImage && image);
+
+  /** Count a frame that was dropped before reaching the writer */
+  inline void drop() noexcept
+  {
+    dropped_++;
+  }
+
+  inline const std::string & path() const noexcept
+  {
+    return path_;
+  }
+
+  /** Number of frames written so far */
+  inline size_t frames() const noexcept
+  {
+    return frames_;
+  }
+
+  /** Number of frames dropped so far */
+  inline size_t dropped() const noexcept
+  {
+    return dropped_;
+  }
+
+private:
+  std::string path_;
+  double fps_;
+  /** Video file, null when writing an image sequence */
+  FILE * video_ = nullptr;
+  /** Size of the video frames, set by the first frame */
+  int width_ = 0;
+  int height_ = 0;
+  /** Planar YUV frame */
+  std::vector<uint8_t> yuv_;
+
+  std::atomic<size_t> frames_{0};
+  std::atomic<size_t> dropped_{0};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<MjImage> queue_;
+  bool stop_ = false;
+  std::thread thread_;
+
+  void run();
+
+  void write(const MjImage & image);
+};
+
+} // namespace mc_mujoco
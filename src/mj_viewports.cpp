@@ -0,0 +1,268 @@
+#include "mj_viewports.h"
+
+#include <GL/glew.h>
+
+#include "imgui.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+namespace mc_mujoco
+{
+
+namespace
+{
+
+/** Fraction of the window covered by a tile along each axis */
+constexpr double TILE_SCALE = 0.25;
+
+/** Space between tiles (pixels) */
+constexpr int TILE_MARGIN = 5;
+
+} // namespace
+
+void MjViewports::addFree(const mjvCamera & camera)
+{
+  MjViewport view;
+  view.name = "Free camera";
+  view.camera = camera;
+  view.camera.type = mjCAMERA_FREE;
+  views_.push_back(view);
+}
+
+void MjViewports::addFixed(const mjModel & model, int camera_id)
+{
+  MjViewport view;
+  const char * name = mj_id2name(&model, mjOBJ_CAMERA, camera_id);
+  view.name = name ? name : fmt::format("Camera {}", camera_id);
+  mjv_defaultCamera(&view.camera);
+  view.camera.type = mjCAMERA_FIXED;
+  view.camera.fixedcamid = camera_id;
+  views_.push_back(view);
+}
+
+void MjViewports::addTracking(const mjModel & model, int body_id)
+{
+  MjViewport view;
+  const char * name = mj_id2name(&model, mjOBJ_BODY, body_id);
+  view.name = fmt::format("Tracking {}", name ? name : std::to_string(body_id));
+  mjv_defaultCamera(&view.camera);
+  view.camera.type = mjCAMERA_TRACKING;
+  view.camera.trackbodyid = body_id;
+  view.camera.distance = 0.5 * model.stat.extent;
+  view.camera.azimuth = model.vis.global.azimuth;
+  view.camera.elevation = model.vis.global.elevation;
+  views_.push_back(view);
+}
+
+void MjViewports::updateCameras(const mjModel & model, mjData & data, mjvScene & scene)
+{
+  if(views_.empty())
+  {
+    return;
+  }
+  mjvGLCamera main[2] = {scene.camera[0], scene.camera[1]};
+  for(size_t i = 0; i < views_.size(); ++i)
+  {
+    auto & view = views_[i];
+    // Views with the same divisor are spread over consecutive frames
+    view.due_ = view.texture_ == 0 || (frame_ + i) % std::max(view.refresh_divisor, 1) == 0;
+    if(view.due_)
+    {
+      mjv_updateCamera(&model, &data, &view.camera, &scene);
+      std::copy(scene.camera, scene.camera + 2, view.glcamera_);
+    }
+  }
+  std::copy(main, main + 2, scene.camera);
+}
+
+void MjViewports::render(mjvScene & scene, mjrContext & context, const mjrRect & window)
+{
+  if(released_.size())
+  {
+    glDeleteTextures(static_cast<GLsizei>(released_.size()), released_.data());
+    released_.clear();
+  }
+  frame_++;
+  if(views_.empty())
+  {
+    return;
+  }
+  int width = std::min(static_cast<int>(TILE_SCALE * window.width), context.offWidth);
+  int height = std::min(static_cast<int>(TILE_SCALE * window.height), context.offHeight);
+  if(width <= 0 || height <= 0)
+  {
+    return;
+  }
+  // Render the views that are due and copy them to their texture
+  mjvGLCamera main[2] = {scene.camera[0], scene.camera[1]};
+  bool rendered = false;
+  for(auto & view : views_)
+  {
+    if(!view.due_)
+    {
+      continue;
+    }
+    view.due_ = false;
+    if(!rendered)
+    {
+      mjr_setBuffer(mjFB_OFFSCREEN, &context);
+      rendered = true;
+    }
+    std::copy(view.glcamera_, view.glcamera_ + 2, scene.camera);
+    mjrRect tile = {0, 0, width, height};
+    mjr_render(tile, &scene, &context);
+    GLuint read = context.offFBO;
+    if(context.offSamples > 0)
+    {
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, context.offFBO);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, context.offFBO_r);
+      glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      read = context.offFBO_r;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+    if(view.texture_ == 0)
+    {
+      glGenTextures(1, &view.texture_);
+    }
+    glBindTexture(GL_TEXTURE_2D, view.texture_);
+    if(view.width_ != width || view.height_ != height)
+    {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+      view.width_ = width;
+      view.height_ = height;
+    }
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  std::copy(main, main + 2, scene.camera);
+  if(rendered)
+  {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    mjr_setBuffer(mjFB_WINDOW, &context);
+  }
+
+  // Draw the cached images along the bottom of the window
+  glViewport(window.left, window.bottom, window.width, window.height);
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  glOrtho(0, window.width, 0, window.height, -1, 1);
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_BLEND);
+  glEnable(GL_TEXTURE_2D);
+  glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+  auto tile_x = [&](size_t i) { return TILE_MARGIN + static_cast<int>(i) * (width + TILE_MARGIN); };
+  size_t ntiles = 0;
+  while(ntiles < views_.size() && tile_x(ntiles) + width <= window.width)
+  {
+    ntiles++;
+  }
+  for(size_t i = 0; i < ntiles; ++i)
+  {
+    if(views_[i].texture_ == 0)
+    {
+      // Added after the cameras were updated, it is rendered on the next frame
+      continue;
+    }
+    int x = tile_x(i);
+    glBindTexture(GL_TEXTURE_2D, views_[i].texture_);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0);
+    glVertex2i(x, TILE_MARGIN);
+    glTexCoord2f(1, 0);
+    glVertex2i(x + width, TILE_MARGIN);
+    glTexCoord2f(1, 1);
+    glVertex2i(x + width, TILE_MARGIN + height);
+    glTexCoord2f(0, 1);
+    glVertex2i(x, TILE_MARGIN + height);
+    glEnd();
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDisable(GL_TEXTURE_2D);
+  // Frame the tiles
+  glLineWidth(1.0f);
+  for(size_t i = 0; i < ntiles; ++i)
+  {
+    int x = tile_x(i);
+    glBegin(GL_LINE_LOOP);
+    glVertex2i(x, TILE_MARGIN);
+    glVertex2i(x + width, TILE_MARGIN);
+    glVertex2i(x + width, TILE_MARGIN + height);
+    glVertex2i(x, TILE_MARGIN + height);
+    glEnd();
+  }
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+}
+
+void MjViewports::drawUI(const mjModel & model, const mjvCamera & main_camera, int selected_body)
+{
+  if(ImGui::Button("Free view"))
+  {
+    addFree(main_camera);
+  }
+  ImGui::SameLine();
+  if(model.ncam > 0 && ImGui::Button("Camera view"))
+  {
+    // Cycle through the model cameras like TAB does for the main view
+    int next = 0;
+    for(auto it = views_.rbegin(); it != views_.rend(); ++it)
+    {
+      if(it->camera.type == mjCAMERA_FIXED)
+      {
+        next = (it->camera.fixedcamid + 1) % model.ncam;
+        break;
+      }
+    }
+    addFixed(model, next);
+  }
+  ImGui::SameLine();
+  if(selected_body > 0 && ImGui::Button("Track selection"))
+  {
+    addTracking(model, selected_body);
+  }
+  for(size_t i = 0; i < views_.size();)
+  {
+    auto & view = views_[i];
+    ImGui::PushID(static_cast<int>(i));
+    ImGui::Text("%s", view.name.c_str());
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80.0f);
+    if(ImGui::InputInt("Divisor", &view.refresh_divisor))
+    {
+      view.refresh_divisor = std::max(view.refresh_divisor, 1);
+    }
+    ImGui::SameLine();
+    bool remove = ImGui::Button("Remove");
+    ImGui::PopID();
+    if(remove)
+    {
+      if(view.texture_)
+      {
+        released_.push_back(view.texture_);
+      }
+      views_.erase(views_.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+    else
+    {
+      ++i;
+    }
+  }
+}
+
+} // namespace mc_mujoco
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "mujoco.h"
+
+#include <string>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+/** Secondary view of the scene drawn in a tile at the bottom of the window */
+struct MjViewport
+{
+  /** Description shown in the panel */
+  std::string name;
+  /** The view is rendered every refresh_divisor frames of the main view, the cached image is drawn in between */
+  int refresh_divisor = 6;
+  mjvCamera camera;
+
+private:
+  friend struct MjViewports;
+  /** OpenGL cameras computed from the simulation state for the next render */
+  mjvGLCamera glcamera_[2];
+  /** True if the view must be rendered on this frame */
+  bool due_ = false;
+  /** Cached image of the view */
+  unsigned int texture_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+/** Secondary views of the scene
+ *
+ * The views share the main view's scene: only the camera changes between views, so a view costs one mjr_render when it
+ * is refreshed and a textured quad otherwise.
+ */
+struct MjViewports
+{
+  /** Add a free camera view starting from the provided camera */
+  void addFree(const mjvCamera & camera);
+
+  /** Add a view from a model camera */
+  void addFixed(const mjModel & model, int camera_id);
+
+  /** Add a view that follows a body */
+  void addTracking(const mjModel & model, int body_id);
+
+  inline bool empty() const noexcept
+  {
+    return views_.empty();
+  }
+
+  /** Compute the cameras of the views due on this frame, must be called after the scene has been updated with the
+   * simulation lock held. The scene cameras are restored before returning.
+   */
+  void updateCameras(const mjModel & model, mjData & data, mjvScene & scene);
+
+  /** Render the views that are due into their cache and draw every view on top of the main view
+   *
+   * \param window Viewport of the main view in the window framebuffer, it is restored on return
+   */
+  void render(mjvScene & scene, mjrContext & context, const mjrRect & window);
+
+  /** Panel section to add, configure and remove the views */
+  void drawUI(const mjModel & model, const mjvCamera & main_camera, int selected_body);
+
+private:
+  std::vector<MjViewport> views_;
+  /** Number of frames drawn */
+  size_t frame_ = 0;
+  /** Textures of the removed views, deleted by the next render */
+  std::vector<unsigned int> released_;
+};
+
+} // namespace mc_mujoco
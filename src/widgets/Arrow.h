@@ -16,21 +16,41 @@ struct Arrow : public MujocoWidget
             const mc_rtc::gui::ArrowConfig & config,
             bool ro)
   {
+    if(start != startMarker_.pose().translation() || end != endMarker_.pose().translation())
+    {
+      changed();
+    }
     startMarker_.mask(ro ? ControlAxis::NONE : ControlAxis::TRANSLATION);
     startMarker_.pose(start);
     endMarker_.mask(ro ? ControlAxis::NONE : ControlAxis::TRANSLATION);
     endMarker_.pose(end);
-    config_ = config;
+    update(config_, config);
   }
 
   void draw3D() override
   {
     const auto & start = startMarker_.pose().translation();
     const auto & end = endMarker_.pose().translation();
-    mclient_.draw_arrow(start, end, config_.shaft_diam, config_.head_diam, config_.head_len, config_.color);
-    bool changed = startMarker_.draw(mclient_.view(), mclient_.projection());
-    if(endMarker_.draw(mclient_.view(), mclient_.projection()) || changed)
+    Eigen::Vector3d center = 0.5 * (start + end);
+    double margin = 0.5 * std::max(config_.shaft_diam, config_.head_diam);
+    Eigen::Vector3d half_size = 0.5 * (end - start).cwiseAbs() + Eigen::Vector3d::Constant(margin);
+    // Far arrows are drawn as lines
+    bool simple = simplified(center, half_size.norm());
+    draw_cached(center, half_size, [&]() {
+      const auto & c = config_;
+      if(simple)
+      {
+        mclient_.draw_line(start, end, c.color);
+      }
+      else
+      {
+        mclient_.draw_arrow(start, end, c.shaft_diam, c.head_diam, c.head_len, c.color);
+      }
+    });
+    bool moved = startMarker_.draw(mclient_.view(), mclient_.projection());
+    if(endMarker_.draw(mclient_.view(), mclient_.projection()) || moved)
     {
+      changed();
       Eigen::Vector6d data;
       data << start, end;
       client.send_request(requestId_, data);
@@ -3,9 +3,45 @@
 #include "../MujocoClient.h"
 #include "Widget.h"
 
+#include <utility>
+
 namespace mc_mujoco
 {
 
+namespace internal
+{
+
+/** Field by field comparison of the mc_rtc GUI configurations, they have no comparison operator */
+inline bool same(const mc_rtc::gui::Color & lhs, const mc_rtc::gui::Color & rhs) noexcept
+{
+  return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b && lhs.a == rhs.a;
+}
+
+inline bool same(const mc_rtc::gui::LineConfig & lhs, const mc_rtc::gui::LineConfig & rhs) noexcept
+{
+  return same(lhs.color, rhs.color) && lhs.width == rhs.width && lhs.style == rhs.style;
+}
+
+inline bool same(const mc_rtc::gui::PointConfig & lhs, const mc_rtc::gui::PointConfig & rhs) noexcept
+{
+  return same(lhs.color, rhs.color) && lhs.scale == rhs.scale;
+}
+
+inline bool same(const mc_rtc::gui::ArrowConfig & lhs, const mc_rtc::gui::ArrowConfig & rhs) noexcept
+{
+  return same(lhs.color, rhs.color) && lhs.shaft_diam == rhs.shaft_diam && lhs.head_diam == rhs.head_diam
+         && lhs.head_len == rhs.head_len && lhs.scale == rhs.scale && lhs.start_point_scale == rhs.start_point_scale
+         && lhs.end_point_scale == rhs.end_point_scale;
+}
+
+template<typename T>
+bool same(const T & lhs, const T & rhs)
+{
+  return lhs == rhs;
+}
+
+} // namespace internal
+
 struct MujocoWidget : public mc_rtc::imgui::Widget
 {
   MujocoWidget(Client & client, const ElementId & id)
@@ -15,6 +51,72 @@ struct MujocoWidget : public mc_rtc::imgui::Widget
 
 protected:
   MujocoClient & mclient_;
+  /** Changes with the data of the widget, the geometry cached by the batch is generated again
+   *
+   * Versions are unique across widgets so a widget re-using the address of a removed widget never matches its cache
+   */
+  uint64_t version_ = new_version();
+
+  /** Give a new version to the widget */
+  inline void changed() noexcept
+  {
+    version_ = new_version();
+  }
+
+  /** Draw the geometry emitted by emit through the batch cache, nothing is emitted if the bounding box of the
+   * geometry is outside of the view
+   */
+  template<typename EmitT>
+  void draw_cached(const Eigen::Vector3d & center, const Eigen::Vector3d & half_size, EmitT && emit)
+  {
+    if(mclient_.visible(center, half_size))
+    {
+      mclient_.batch().cached(this, version_, std::forward<EmitT>(emit));
+    }
+    else
+    {
+      mclient_.batch().retain(this);
+    }
+  }
+
+  template<typename EmitT>
+  void draw_cached(const Eigen::AlignedBox3d & box, EmitT && emit)
+  {
+    draw_cached(box.center(), 0.5 * box.sizes(), std::forward<EmitT>(emit));
+  }
+
+  /** True if the widget should be drawn with less details, the widget gets a new version when this changes */
+  bool simplified(const Eigen::Vector3d & center, double radius)
+  {
+    bool far = mclient_.far(center, radius);
+    if(far != simplified_)
+    {
+      simplified_ = far;
+      changed();
+    }
+    return far;
+  }
+
+  /** Assign value to member, the widget gets a new version if the value changed */
+  template<typename T>
+  void update(T & member, const T & value)
+  {
+    if(!internal::same(member, value))
+    {
+      member = value;
+      changed();
+    }
+  }
+
+private:
+  /** Result of the last call to simplified */
+  bool simplified_ = false;
+
+  static inline uint64_t new_version() noexcept
+  {
+    static uint64_t version = 0;
+    return ++version;
+  }
 };
 
 } // namespace mc_mujoco
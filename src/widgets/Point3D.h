@@ -14,13 +14,15 @@ struct Point3D : public TransformBase<ControlAxis::TRANSLATION>
   void data(bool ro, const Eigen::Vector3d & pos, const mc_rtc::gui::PointConfig & config)
   {
     TransformBase::data(ro, pos);
-    config_ = config;
+    update(config_, config);
   }
 
   void draw3D() override
   {
     TransformBase::draw3D();
-    mclient_.draw_sphere(marker_.pose().translation(), config_.scale, config_.color);
+    const auto & pos = marker_.pose().translation();
+    draw_cached(pos, Eigen::Vector3d::Constant(config_.scale),
+                [&]() { mclient_.draw_sphere(pos, config_.scale, config_.color); });
   }
 
 private:
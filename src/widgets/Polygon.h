@@ -14,22 +14,38 @@ struct Polygon : public MujocoWidget
     if(points_ != points)
     {
       points_ = points;
+      changed();
+      box_.setEmpty();
+      for(const auto & polygon : points_)
+      {
+        for(const auto & p : polygon)
+        {
+          box_.extend(p);
+        }
+      }
     }
-    config_ = config;
+    update(config_, config);
   }
 
   void draw3D() override
   {
-    for(const auto & p : points_)
+    if(box_.isEmpty())
     {
-      // FIXME Style is not supported by imgui drawing API
-      mclient_.draw_polygon(p, config_.color, config_.width);
+      return;
     }
+    draw_cached(box_, [&]() {
+      for(const auto & p : points_)
+      {
+        // FIXME Style is not supported by imgui drawing API
+        mclient_.draw_polygon(p, config_.color, config_.width);
+      }
+    });
   }
 
 private:
   std::vector<std::vector<Eigen::Vector3d>> points_;
   mc_rtc::gui::LineConfig config_;
+  Eigen::AlignedBox3d box_;
 };
 
 } // namespace mc_mujoco
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "MujocoWidget.h"
+#include "details/Simplify.h"
+
+#include <deque>
+#include <type_traits>
 
 namespace mc_mujoco
 {
@@ -12,14 +16,36 @@ struct Trajectory : public MujocoWidget
 
   void data(const T & point, const mc_rtc::gui::LineConfig & config)
   {
+    // Once the buffer is full the oldest points are removed by blocks and the cached geometry is generated again, so
+    // it never shows points that are no longer in the buffer
+    size_t capacity = std::max<size_t>(mclient_.trajectory_max_points, 2);
+    if(points_.size() == capacity)
+    {
+      size_t removed = std::clamp<size_t>(capacity / 2, 1, max_pending);
+      points_.erase(points_.begin(), points_.begin() + static_cast<std::ptrdiff_t>(removed));
+      changed();
+      compute_box();
+    }
     points_.push_back(point);
-    config_ = config;
+    box_.extend(position(point));
+    // The newest points are drawn as they are until there are enough of them to generate the cached geometry again
+    if(++pending_ >= max_pending)
+    {
+      changed();
+    }
+    update(config_, config);
   }
 
   void data(const std::vector<T> & points, const mc_rtc::gui::LineConfig & config)
   {
-    points_ = points;
-    config_ = config;
+    if(!std::equal(points_.begin(), points_.end(), points.begin(), points.end()))
+    {
+      points_.assign(points.begin(), points.end());
+      pending_ = 0;
+      changed();
+      compute_box();
+    }
+    update(config_, config);
   }
 
   void draw3D() override
@@ -28,35 +54,108 @@ struct Trajectory : public MujocoWidget
     {
       return;
     }
-    for(size_t i = 0; i < points_.size() - 1; ++i)
+    // The simplification depends on the camera
+    if(view_version_ != mclient_.view_version())
+    {
+      view_version_ = mclient_.view_version();
+      changed();
+    }
+    // Include the markers drawn at the ends of the trajectory
+    Eigen::AlignedBox3d box((box_.min().array() - 0.1).matrix(), (box_.max().array() + 0.1).matrix());
+    bool simple = simplified(box.center(), 0.5 * box.diagonal().norm());
+    draw_cached(box, [this]() { draw_lines(); });
+    if(pending_ < max_pending)
+    {
+      for(size_t i = points_.size() - std::min(pending_, points_.size() - 1); i < points_.size(); ++i)
+      {
+        mclient_.draw_line(points_[i - 1], points_[i], config_.color, config_.width);
+      }
+    }
+    draw_markers(simple);
+  }
+
+private:
+  /** Points of the trajectory from the oldest to the newest */
+  std::deque<T> points_;
+  mc_rtc::gui::LineConfig config_;
+  /** MujocoClient::view_version used by the cached geometry */
+  uint64_t view_version_ = 0;
+  /** Bounding box of the points */
+  Eigen::AlignedBox3d box_;
+  /** Number of the newest points that are not in the cached geometry */
+  size_t pending_ = 0;
+  /** Maximum number of points drawn outside of the cached geometry */
+  static constexpr size_t max_pending = 100;
+  /** Projection of the points used by the simplification */
+  std::vector<Eigen::Vector2f> screen_;
+  std::vector<bool> visible_;
+  std::vector<size_t> keep_;
+
+  void compute_box()
+  {
+    box_.setEmpty();
+    for(const auto & p : points_)
+    {
+      box_.extend(position(p));
+    }
+  }
+
+  /** Draw the lines of the trajectory */
+  void draw_lines()
+  {
+    pending_ = 0;
+    // Screen-space simplification: a point is skipped if it stays within the tolerance of the line drawn instead
+    screen_.resize(points_.size());
+    visible_.resize(points_.size());
+    for(size_t i = 0; i < points_.size(); ++i)
+    {
+      visible_[i] = mclient_.project(position(points_[i]), screen_[i]);
+    }
+    internal::simplify_polyline(screen_, visible_, mclient_.trajectory_tolerance, keep_);
+    for(size_t i = 1; i < keep_.size(); ++i)
     {
-      mclient_.draw_line(points_[i], points_[i + 1], config_.color);
+      mclient_.draw_line(points_[keep_[i - 1]], points_[keep_[i]], config_.color, config_.width);
     }
+  }
+
+  /** Draw the markers at the ends of the trajectory, they are simplified or omitted if simple is true */
+  void draw_markers(bool simple)
+  {
+    const auto & front = points_.front();
+    const auto & back = points_.back();
     if constexpr(std::is_same_v<T, sva::PTransformd>)
     {
       if(points_.size() < 10) // For "small" trajectories, display all points
       {
         for(const auto & p : points_)
         {
-          mclient_.draw_frame(p);
+          mclient_.draw_frame(p, 0.1, simple);
         }
       }
       else // Otherwise draw the start and end points
       {
-        mclient_.draw_frame(points_[0]);
-        mclient_.draw_frame(points_.back());
+        mclient_.draw_frame(front, 0.1, simple);
+        mclient_.draw_frame(back, 0.1, simple);
       }
     }
-    else
+    else if(!simple)
     {
-      mclient_.draw_box(points_[0], Eigen::Matrix3d::Identity(), Eigen::Vector3d::Constant(0.04), config_.color);
-      mclient_.draw_sphere(points_.back(), 0.04, config_.color);
+      mclient_.draw_box(front, Eigen::Matrix3d::Identity(), Eigen::Vector3d::Constant(0.04), config_.color);
+      mclient_.draw_sphere(back, 0.04, config_.color);
     }
   }
 
-private:
-  std::vector<T> points_;
-  mc_rtc::gui::LineConfig config_;
+  static inline const Eigen::Vector3d & position(const T & point) noexcept
+  {
+    if constexpr(std::is_same_v<T, sva::PTransformd>)
+    {
+      return point.translation();
+    }
+    else
+    {
+      return point;
+    }
+  }
 };
 
 } // namespace mc_mujoco
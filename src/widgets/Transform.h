@@ -12,7 +12,9 @@ struct TransformWidget : public TransformBase<ControlAxis::ALL>
   void draw3D() override
   {
     TransformBase::draw3D();
-    mclient_.draw_frame(marker_.pose());
+    const auto & pos = marker_.pose();
+    bool simple = simplified(pos.translation(), 0.1);
+    draw_cached(pos.translation(), Eigen::Vector3d::Constant(0.1), [&]() { mclient_.draw_frame(pos, 0.1, simple); });
   }
 };
 
@@ -16,15 +16,79 @@ mc_rtc::gui::Color color(const rbd::parsers::Material & m)
   return {1.0f, 1.0f, 1.0f, 1.0f};
 }
 
+/** Older RBDyn versions only have a uniform mesh scale */
+template<typename MeshT, typename = void>
+struct has_scaleV : std::false_type
+{
+};
+
+template<typename MeshT>
+struct has_scaleV<MeshT, std::void_t<decltype(std::declval<MeshT>().scaleV)>> : std::true_type
+{
+};
+
+template<typename MeshT>
+Eigen::Vector3d mesh_scale(const MeshT & mesh)
+{
+  if constexpr(has_scaleV<MeshT>::value)
+  {
+    return mesh.scaleV;
+  }
+  else
+  {
+    return Eigen::Vector3d::Constant(mesh.scale);
+  }
+}
+
+/** True if both visuals are drawn the same way (the origin is not compared) */
+bool same_appearance(const rbd::parsers::Visual & lhs, const rbd::parsers::Visual & rhs)
+{
+  using Geometry = rbd::parsers::Geometry;
+  auto lc = color(lhs.material);
+  auto rc = color(rhs.material);
+  if(lhs.geometry.type != rhs.geometry.type || lc.r != rc.r || lc.g != rc.g || lc.b != rc.b || lc.a != rc.a)
+  {
+    return false;
+  }
+  switch(lhs.geometry.type)
+  {
+    case Geometry::Type::MESH:
+    {
+      const auto & l = boost::get<Geometry::Mesh>(lhs.geometry.data);
+      const auto & r = boost::get<Geometry::Mesh>(rhs.geometry.data);
+      return l.filename == r.filename && mesh_scale(l) == mesh_scale(r);
+    }
+    case Geometry::Type::BOX:
+      return boost::get<Geometry::Box>(lhs.geometry.data).size == boost::get<Geometry::Box>(rhs.geometry.data).size;
+    case Geometry::Type::CYLINDER:
+    {
+      const auto & l = boost::get<Geometry::Cylinder>(lhs.geometry.data);
+      const auto & r = boost::get<Geometry::Cylinder>(rhs.geometry.data);
+      return l.radius == r.radius && l.length == r.length;
+    }
+    case Geometry::Type::SPHERE:
+      return boost::get<Geometry::Sphere>(lhs.geometry.data).radius
+             == boost::get<Geometry::Sphere>(rhs.geometry.data).radius;
+    default:
+      return true;
+  }
+}
+
 } // namespace internal
 
 Visual::Visual(Client & client, const ElementId & id) : MujocoWidget(client, id) {}
 
 void Visual::data(const rbd::parsers::Visual & visual, const sva::PTransformd & pos)
 {
-  visual_ = visual;
   // Bake the visual origin in the position
-  pos_ = visual.origin * pos;
+  sva::PTransformd X = visual.origin * pos;
+  if(!valid_ || X != pos_ || !internal::same_appearance(visual, visual_))
+  {
+    valid_ = true;
+    changed();
+  }
+  visual_ = visual;
+  pos_ = X;
 }
 
 void Visual::draw2D()
@@ -41,12 +105,8 @@ void Visual::draw3D()
   using Geometry = rbd::parsers::Geometry;
   using Type = rbd::parsers::Geometry::Type;
   auto handleMesh = [&]() {
-    static bool warned_about_mesh = false;
-    if(!warned_about_mesh)
-    {
-      mc_rtc::log::warning("[mc_mujoco] Does not support mesh Visual elements");
-      warned_about_mesh = true;
-    }
+    const auto & mesh = boost::get<Geometry::Mesh>(visual_.geometry.data);
+    mclient_.draw_mesh(mesh.filename, pos_, internal::mesh_scale(mesh), internal::color(visual_.material));
   };
   auto handleBox = [&]() {
     const auto & box = boost::get<Geometry::Box>(visual_.geometry.data);
@@ -63,23 +123,60 @@ void Visual::draw3D()
     const auto & sphere = boost::get<rbd::parsers::Geometry::Sphere>(visual_.geometry.data);
     mclient_.draw_sphere(pos_.translation(), sphere.radius, internal::color(visual_.material));
   };
+  auto draw = [&]() {
+    switch(visual_.geometry.type)
+    {
+      case Type::MESH:
+        handleMesh();
+        break;
+      case Type::BOX:
+        handleBox();
+        break;
+      case Type::CYLINDER:
+        handleCylinder();
+        break;
+      case Type::SPHERE:
+        handleSphere();
+        break;
+      default:
+        break;
+    }
+  };
+  // Radius of the bounding sphere, negative if it is not known
+  double radius = -1.0;
   switch(visual_.geometry.type)
   {
     case Type::MESH:
-      handleMesh();
+    {
+      const auto & mesh = boost::get<Geometry::Mesh>(visual_.geometry.data);
+      radius = mclient_.batch().mesh_radius(mesh.filename);
+      radius = radius < 0 ? radius : radius * internal::mesh_scale(mesh).cwiseAbs().maxCoeff();
       break;
+    }
     case Type::BOX:
-      handleBox();
+      // The box is drawn with its size as half-extents (see handleBox)
+      radius = boost::get<Geometry::Box>(visual_.geometry.data).size.norm();
       break;
     case Type::CYLINDER:
-      handleCylinder();
+    {
+      const auto & cyl = boost::get<Geometry::Cylinder>(visual_.geometry.data);
+      radius = Eigen::Vector2d(cyl.radius, 0.5 * cyl.length).norm();
       break;
+    }
     case Type::SPHERE:
-      handleSphere();
+      radius = boost::get<Geometry::Sphere>(visual_.geometry.data).radius;
       break;
     default:
       break;
   }
+  if(radius < 0)
+  {
+    mclient_.batch().cached(this, version_, draw);
+  }
+  else
+  {
+    draw_cached(pos_.translation(), Eigen::Vector3d::Constant(radius), draw);
+  }
 }
 
 } // namespace mc_mujoco
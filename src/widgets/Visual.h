@@ -19,6 +19,7 @@ private:
   rbd::parsers::Visual visual_;
   sva::PTransformd pos_;
   bool show_ = true;
+  bool valid_ = false;
 };
 
 } // namespace mc_mujoco
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace mc_mujoco
+{
+
+namespace internal
+{
+
+/** Distance from p to the [a, b] segment */
+inline float distance_to_segment(const Eigen::Vector2f & p, const Eigen::Vector2f & a, const Eigen::Vector2f & b)
+{
+  Eigen::Vector2f ab = b - a;
+  float l2 = ab.squaredNorm();
+  if(l2 == 0.0f)
+  {
+    return (p - a).norm();
+  }
+  float t = std::clamp((p - a).dot(ab) / l2, 0.0f, 1.0f);
+  return (a + t * ab - p).norm();
+}
+
+/** Simplify a polyline drawn on screen with the Douglas-Peucker algorithm
+ *
+ * Every skipped point is within \p tolerance of the segment drawn in its place. Points whose projection is not
+ * available (\p visible is false) and their neighbours are always kept.
+ *
+ * \param points Projection of the points
+ *
+ * \param visible True if the projection of the point is available
+ *
+ * \param tolerance Maximum distance from a skipped point to the drawn line
+ *
+ * \param keep Indices of the points to draw in order, the first and last points are always kept
+ */
+inline void simplify_polyline(const std::vector<Eigen::Vector2f> & points,
+                              const std::vector<bool> & visible,
+                              float tolerance,
+                              std::vector<size_t> & keep)
+{
+  keep.clear();
+  if(points.empty())
+  {
+    return;
+  }
+  std::vector<bool> kept(points.size(), false);
+  kept.front() = true;
+  kept.back() = true;
+  for(size_t i = 0; i < points.size(); ++i)
+  {
+    if(!visible[i])
+    {
+      kept[i] = true;
+      kept[i > 0 ? i - 1 : i] = true;
+      kept[std::min(i + 1, points.size() - 1)] = true;
+    }
+  }
+  // Simplify the points between consecutive kept points, only visible points are in between, the recursion is replaced
+  // by a stack of [first, last] ranges
+  std::vector<std::pair<size_t, size_t>> ranges;
+  size_t first = 0;
+  for(size_t i = 1; i < points.size(); ++i)
+  {
+    if(kept[i])
+    {
+      ranges.emplace_back(first, i);
+      first = i;
+    }
+  }
+  while(ranges.size())
+  {
+    auto [a, b] = ranges.back();
+    ranges.pop_back();
+    size_t farthest = a;
+    float max_distance = tolerance;
+    for(size_t i = a + 1; i < b; ++i)
+    {
+      float d = distance_to_segment(points[i], points[a], points[b]);
+      if(d > max_distance)
+      {
+        farthest = i;
+        max_distance = d;
+      }
+    }
+    if(farthest != a)
+    {
+      kept[farthest] = true;
+      ranges.emplace_back(a, farthest);
+      ranges.emplace_back(farthest, b);
+    }
+  }
+  for(size_t i = 0; i < points.size(); ++i)
+  {
+    if(kept[i])
+    {
+      keep.push_back(i);
+    }
+  }
+}
+
+} // namespace internal
+
+} // namespace mc_mujoco
@@ -18,6 +18,10 @@ struct TransformBase : public MujocoWidget
 
   void data(bool ro, const sva::PTransformd & pos)
   {
+    if(pos != marker_.pose())
+    {
+      changed();
+    }
     marker_.mask(ro ? ControlAxis::NONE : ctl);
     marker_.pose(pos);
   }
@@ -27,6 +31,7 @@ struct TransformBase : public MujocoWidget
     const auto & pos = marker_.pose();
     if(marker_.draw(mclient_.view(), mclient_.projection()))
     {
+      changed();
       if constexpr(ctl == ControlAxis::TRANSLATION)
       {
         client.send_request(requestId_, pos.translation());
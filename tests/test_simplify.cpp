@@ -0,0 +1,92 @@
+#include "widgets/details/Simplify.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace mc_mujoco;
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool condition, const char * what)
+{
+  if(!condition)
+  {
+    std::cerr << "FAILED: " << what << "\n";
+    failures++;
+  }
+}
+
+/** Largest distance from a point to the simplified polyline drawn in its place */
+float max_error(const std::vector<Eigen::Vector2f> & points, const std::vector<size_t> & keep)
+{
+  float error = 0.0f;
+  for(size_t k = 1; k < keep.size(); ++k)
+  {
+    for(size_t i = keep[k - 1]; i <= keep[k]; ++i)
+    {
+      error = std::max(error, internal::distance_to_segment(points[i], points[keep[k - 1]], points[keep[k]]));
+    }
+  }
+  return error;
+}
+
+void test_dense_half_circle()
+{
+  // Consecutive points are about 0.3 px apart so each of them is close to a chord that keeps growing
+  const size_t n = 2001;
+  const float radius = 200.0f;
+  std::vector<Eigen::Vector2f> points(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    float theta = static_cast<float>(M_PI) * static_cast<float>(i) / static_cast<float>(n - 1);
+    points[i] = Eigen::Vector2f(radius * std::cos(theta), radius * std::sin(theta));
+  }
+  std::vector<bool> visible(n, true);
+  std::vector<size_t> keep;
+  internal::simplify_polyline(points, visible, 1.0f, keep);
+  check(keep.size() > 2, "the bend of a dense half circle is kept");
+  check(keep.size() < n / 10, "a dense half circle is simplified");
+  check(keep.front() == 0 && keep.back() == n - 1, "the ends of a half circle are kept");
+  check(max_error(points, keep) <= 1.0f, "every point of a half circle is within the tolerance");
+}
+
+void test_straight_line()
+{
+  std::vector<Eigen::Vector2f> points;
+  for(int i = 0; i < 100; ++i)
+  {
+    points.emplace_back(static_cast<float>(i), 0.0f);
+  }
+  std::vector<bool> visible(points.size(), true);
+  std::vector<size_t> keep;
+  internal::simplify_polyline(points, visible, 1.0f, keep);
+  check(keep.size() == 2, "a straight line is drawn as one segment");
+}
+
+void test_hidden_points()
+{
+  std::vector<Eigen::Vector2f> points;
+  for(int i = 0; i < 100; ++i)
+  {
+    points.emplace_back(static_cast<float>(i), 0.0f);
+  }
+  std::vector<bool> visible(points.size(), true);
+  visible[50] = false;
+  std::vector<size_t> keep;
+  internal::simplify_polyline(points, visible, 1.0f, keep);
+  check(keep == std::vector<size_t>({0, 49, 50, 51, 99}), "points without a projection and their neighbours are kept");
+}
+
+} // namespace
+
+int main()
+{
+  test_dense_half_circle();
+  test_straight_line();
+  test_hidden_points();
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}